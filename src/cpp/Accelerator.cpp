@@ -0,0 +1,213 @@
+#include "Accelerator.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include "Fnv1a.h"
+
+const unsigned int BlockAccelerator::MAX_BLOCK_SIZE;
+
+// Steps simulated in a block before giving up on it (the head may never leave it)
+static const unsigned long long MAX_BLOCK_STEPS = 1 << 16;
+// Lookups between checks that the cache pays off
+static const unsigned int WINDOW = 1024;
+// A lookup costs about as much as this many normal steps, so hits must save more than that on average
+static const unsigned int LOOKUP_COST = 4;
+// Normal steps after the cache did not pay off. Doubles every time it does not pay off again
+static const unsigned long long MIN_BACKOFF = 1 << 16;
+static const unsigned long long MAX_BACKOFF = 1 << 24;
+
+static uint64_t hash(int state, unsigned int offset, const char* cells, unsigned int size)
+{
+    Fnv1a h;
+    for (unsigned int i = 0; i < sizeof(state); i++)
+        h.add(static_cast<unsigned char>(static_cast<unsigned int>(state) >> (i * 8)));
+    h.add(static_cast<unsigned char>(offset));
+    h.add(cells, size);
+    return h.value();
+}
+
+BlockAccelerator::BlockAccelerator(const TuringProgram& _program, unsigned int _block_size, size_t capacity)
+    : program(_program), block_size(std::max(1u, std::min(_block_size, MAX_BLOCK_SIZE))), left_growth(0),
+      skipping(false), skipped_block(0), backoff(0), backoff_length(MIN_BACKOFF), window_lookups(0), window_saved(0),
+      lookups(0), hits(0), saved_steps(0), simulated_steps(0), plain_steps(0), fallbacks(0)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size *= 2;
+
+    Entry empty{};
+    empty.state = TuringProgram::WILDCARD;
+    cache.assign(size, empty);
+}
+
+StepResult BlockAccelerator::plain_step(TuringCore& core)
+{
+    StepResult result = core.step(program);
+    plain_steps++;
+    if (result == StepResult::ok && core.last_event().move == StepEvent::Move::grow_left)
+        left_growth++;
+    return result;
+}
+
+StepResult BlockAccelerator::step(TuringCore& core, unsigned long long max_steps)
+{
+    if (backoff > 0)
+    {
+        backoff--;
+        return plain_step(core);
+    }
+
+    // Where the head is in its block
+    long long cell = static_cast<long long>(core.position) - static_cast<long long>(left_growth);
+    unsigned int offset = static_cast<unsigned int>((cell % block_size + block_size) % block_size);
+
+    // The head has to be able to leave the block on either side without the tape growing
+    if (offset >= core.position || core.position - offset + block_size >= core.tape.size())
+        return plain_step(core);
+    size_t start = core.position - offset;
+
+    if (skipping)
+    {
+        if (start == skipped_block)
+            return plain_step(core);
+        skipping = false;
+    }
+
+    const char* cells = &core.tape[start];
+    Entry& entry = cache[hash(core.state, offset, cells, block_size) & (cache.size() - 1)];
+    lookups++;
+    window_lookups++;
+
+    bool hit = entry.state == core.state && entry.offset == offset && std::memcmp(entry.cells, cells, block_size) == 0;
+    if (hit)
+    {
+        hits++;
+        if (max_steps == 0 || core.steps + entry.steps <= max_steps)
+        {
+            saved_steps += entry.steps;
+            window_saved += entry.steps;
+        }
+    }
+    else
+    {
+        Entry result{};
+        result.state = core.state;
+        result.offset = offset;
+        std::memcpy(result.cells, cells, block_size);
+
+        if (!simulate(result))
+        {
+            skipping = true;
+            skipped_block = start;
+            return plain_step(core);
+        }
+        simulated_steps += result.steps;
+        entry = result;
+    }
+
+    // Finish the run one step at a time so that it stops exactly at max_steps
+    if (max_steps != 0 && core.steps + entry.steps > max_steps)
+    {
+        skipping = true;
+        skipped_block = start;
+        return plain_step(core);
+    }
+
+    std::memcpy(&core.tape[start], entry.new_cells, block_size);
+    core.position = static_cast<unsigned int>(entry.exit_right ? start + block_size : start - 1);
+    core.state = entry.new_state;
+    core.steps += entry.steps;
+    core.event = StepEvent{};
+
+    if (window_lookups >= WINDOW)
+    {
+        if (window_saved < static_cast<unsigned long long>(window_lookups) * LOOKUP_COST)
+        {
+            backoff = backoff_length;
+            backoff_length = std::min(backoff_length * 2, MAX_BACKOFF);
+            fallbacks++;
+        }
+        else
+            backoff_length = MIN_BACKOFF;
+
+        window_lookups = 0;
+        window_saved = 0;
+    }
+
+    return StepResult::ok;
+}
+
+bool BlockAccelerator::simulate(Entry& entry) const
+{
+    char cells[MAX_BLOCK_SIZE];
+    std::memcpy(cells, entry.cells, block_size);
+    int state = entry.state;
+    unsigned int offset = entry.offset;
+    unsigned long long steps = 0;
+
+    while (steps < MAX_BLOCK_STEPS)
+    {
+        // Halting and errors are left to TuringCore::step()
+        const TuringInstruction* instruction = program.match(state, cells[offset]);
+        if (instruction == nullptr || !instruction->error.empty())
+            return false;
+
+        if (instruction->new_symbol != '*')
+            cells[offset] = instruction->new_symbol;
+        if (instruction->new_state != TuringProgram::WILDCARD)
+            state = instruction->new_state;
+        steps += instruction->steps;
+
+        bool exit_right;
+        switch (instruction->move_direction)
+        {
+        case '*':
+            continue;
+        case 'l':
+            if (offset > 0)
+            {
+                offset--;
+                continue;
+            }
+            exit_right = false;
+            break;
+        case 'r':
+            if (offset < block_size - 1)
+            {
+                offset++;
+                continue;
+            }
+            exit_right = true;
+            break;
+        default:
+            return false;
+        }
+
+        entry.new_state = state;
+        entry.exit_right = exit_right;
+        entry.steps = steps;
+        std::memcpy(entry.new_cells, cells, block_size);
+        return true;
+    }
+
+    return false;
+}
+
+void BlockAccelerator::print_report(std::ostream& out, unsigned long long steps, double seconds) const
+{
+    // Work is counted in normal steps, with every lookup as 1
+    unsigned long long work = plain_steps + simulated_steps + hits;
+
+    char numbers[128];
+    std::snprintf(numbers, sizeof(numbers), "cache-hit-rate %.4f\nspeedup %.2f\nsteps-per-second %.0f\n",
+                  lookups > 0 ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0,
+                  work > 0 ? static_cast<double>(steps) / static_cast<double>(work) : 1.0,
+                  seconds > 0 ? static_cast<double>(steps) / seconds : 0.0);
+
+    out << "block-size " << block_size << '\n'
+        << "cache-lookups " << lookups << '\n'
+        << "cache-hits " << hits << '\n'
+        << numbers
+        << "cached-steps " << saved_steps << '\n'
+        << "fallbacks " << fallbacks << std::endl;
+}
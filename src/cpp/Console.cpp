@@ -1,11 +1,14 @@
 #include "Console.h"
 #include <sstream>
-#ifndef WIN32 // Linux
+#include <cstdio>
+#ifdef WIN32
+#include <conio.h>
+#else // Linux
 #include <curses.h>
 #endif
 
 TuringConsole::TuringConsole(std::ifstream& _code_file)
-    : turing_position(0), current_code_line(0), code_file(_code_file)
+    : current_code_line(0), code_file(_code_file), code_scroll(0)
 #ifdef WIN32
     , console_info({})
 #endif
@@ -76,32 +79,6 @@ void TuringConsole::set_color(color col)
 }
 #endif
 
-void TuringConsole::set_tape_cursor(unsigned short position, const std::string& tape)
-{
-#ifdef WIN32
-    set_position({ (unsigned short)(tape_display_start.x + turing_position), tape_display_start.y });
-    set_color(color::reset);
-    std::cout << tape[turing_position];
-#else
-    mvaddch(tape_display_start.y, tape_display_start.x + turing_position, tape[turing_position]);
-#endif
-
-    // Highlight new position
-#ifdef WIN32
-    set_position({ (unsigned short)(tape_display_start.x + position), tape_display_start.y });
-    set_color(color::cyan_bg);
-    std::cout << tape[position];
-    set_color(color::reset);
-#else
-    attron(COLOR_PAIR(TAPE_CURSOR));
-    mvaddch(tape_display_start.y, tape_display_start.x + position, tape[position]);
-    attroff(COLOR_PAIR(TAPE_CURSOR));
-    refresh();
-#endif
-
-    turing_position = position;
-}
-
 void TuringConsole::set_position(coord pos) // NOLINT(readability-convert-member-functions-to-static)
 {
 #if WIN32
@@ -112,92 +89,89 @@ void TuringConsole::set_position(coord pos) // NOLINT(readability-convert-member
 #endif
 }
 
-void TuringConsole::set_current_code_line(unsigned short line, std::ifstream& file)
+void TuringConsole::set_current_code_line(unsigned int line)
 {
-    // start from the beginning
-    file.clear();
-    file.seekg(0);
+    unsigned int previous = current_code_line;
+    current_code_line = line;
+
+    // Reset color of the previous line
+    if (previous != line)
+        draw_code_line(previous);
+    draw_code_line(line);
+}
 
+void TuringConsole::draw_code_line(unsigned int line)
+{
     // First line is line 1
-    unsigned short line_count = 0;
-    // completed resetting the current_code_line
-    bool resetted = false;
-    // Completed highlighting the line
-    bool colored = false;
+    if (line <= code_scroll || line > code_scroll + code_rows())
+        return;
 
-    if (file.is_open())
-    {
-        // Stop when both tasks (resetting current_line and highlighting target line) are complete
-        while (file.good() && !(resetted && colored))
-        {
-            std::string s_line;
-            std::getline(file, s_line);
-            // First line is line 1
-            line_count++;
+    auto y = (unsigned short)(code_start.y + line - 1 - code_scroll);
+    std::string text = line <= code_lines.size() ? code_lines[line - 1] : "";
+    // Longer lines would wrap onto the next one
+    if (text.size() > (size_t)(width - code_start.x))
+        text.resize(width - code_start.x);
+
+    bool active = line == current_code_line;
+    size_t comment = active ? std::string::npos : text.find(';');
+    std::string code = text.substr(0, comment);
 
-            // Reset color of current_line
-            if (line_count == current_code_line)
-            {
-#ifdef WIN32
-                set_position({ code_start.x, (unsigned short)(line_count + code_start.y) });
-                set_color(color::reset);
-                std::cout << s_line;
-#else
-                mvaddstr(line_count + code_start.y, code_start.x, s_line.c_str());
-#endif
-                resetted = true;
-            }
-            // line and current_code_line could be the same, so no elseif
-            
-            // Set color of target line
-            if (line_count == line)
-            {
 #ifdef WIN32
-                set_position({ code_start.x, (unsigned short)(line_count + code_start.y) });
-                set_color(color::green_bg);
-                std::cout << s_line;
-                set_color(color::reset);
-#else
-                attron(COLOR_PAIR(ACTIVE_CODE_LINE));
-                mvaddstr(line_count + code_start.y, code_start.x, s_line.c_str());
-                attroff(COLOR_PAIR(ACTIVE_CODE_LINE));
-#endif
-                colored = true;
-            }
-        }
+    set_position({ code_start.x, y });
+    set_color(color::reset);
+    std::cout << std::string(width - code_start.x, ' ');
+    set_position({ code_start.x, y });
 
-        // target line is greater than the number of lines in the file
-        if (!colored)
-            std::cerr << "Argument <line> is greater than lines in the file" << std::endl;
-        // Can safely set current_code_line
-        else
-            current_code_line = line;
+    if (active)
+        set_color(color::green_bg);
+    std::cout << code;
+    if (comment != std::string::npos)
+    {
+        set_color(color::light_black_fg);
+        std::cout << text.substr(comment);
+    }
+    set_color(color::reset);
+#else
+    move(y, code_start.x);
+    clrtoeol();
+
+    if (active)
+        attron(COLOR_PAIR(ACTIVE_CODE_LINE));
+    addstr(code.c_str());
+    attroff(COLOR_PAIR(ACTIVE_CODE_LINE));
+    if (comment != std::string::npos)
+    {
+        attron(COLOR_PAIR(COMMENT_LINE));
+        addstr(text.substr(comment).c_str());
+        attroff(COLOR_PAIR(COMMENT_LINE));
     }
-    else
-        std::cerr << "Error opening file containing Turing instructions" << std::endl;
-
-#ifndef WIN32 // Linux
-    refresh();
 #endif
-    file.clear();
-    file.seekg(0); 
 }
 
-void TuringConsole::write_at(char symbol, unsigned short tape_position)
+void TuringConsole::scroll_code(int lines)
 {
-#ifdef WIN32
-    set_position({ (unsigned short)(tape_display_start.x + tape_position), tape_display_start.y });
-    if (turing_position == tape_position)
-        set_color(color::cyan_bg);
-    std::cout << symbol;
-    set_color(color::reset);
-#else
-    if (turing_position == tape_position)
-        attron(COLOR_PAIR(TAPE_CURSOR));
-    mvaddch(tape_display_start.y, tape_display_start.x + tape_position, symbol);
-    attroff(COLOR_PAIR(TAPE_CURSOR));
-    refresh();
-#endif
+    long long last = code_lines.empty() ? 0 : (long long)code_lines.size() - 1;
+    long long target = (long long)code_scroll + lines;
+    if (target < 0)
+        target = 0;
+    if (target > last)
+        target = last;
+    if (target == code_scroll)
+        return;
+
+    code_scroll = (unsigned int)target;
+    for (unsigned int row = 1; row <= code_rows(); row++)
+        draw_code_line(code_scroll + row);
+}
+
+void TuringConsole::show_code_line(unsigned int line)
+{
+    if (line == 0)
+        return;
+    if (line <= code_scroll)
+        scroll_code((int)line - 1 - (int)code_scroll);
+    else if (line > code_scroll + code_rows())
+        scroll_code((int)(line - code_rows() - code_scroll));
 }
 
 void TuringConsole::draw_tape_scrollers(bool arrow1_disabled, bool arrow2_disabled) // NOLINT(readability-make-member-function-const)
@@ -264,81 +238,96 @@ void TuringConsole::draw_tape_scrollers(bool arrow1_disabled, bool arrow2_disabl
 #endif
 }
 
-void TuringConsole::set_tape_value(const std::string& tape)
+void TuringConsole::set_tape_value(const MachineFrame& frame)
 {
     set_position(tape_display_start);
 
-    if (tape.size() > tape_display_width)
-        ; // TODO: note: tape cursor (cyan) should be in the middle.
-    else
-        for (unsigned int i = 0; i < tape.size(); i++)
-            if (i == turing_position)
-            {
+    // Blanks past the end of the tape clear what was drawn before
+    for (unsigned int i = 0; i < tape_display_width; i++)
+    {
+        char symbol = i < frame.window_length ? frame.tape[i] : ' ';
+
+        if (i < frame.window_length && frame.window_start + i == frame.position)
+        {
 #ifdef WIN32
-                set_color(color::cyan_bg);
-                std::cout << tape[i];
-                set_color(color::reset);
+            set_color(color::cyan_bg);
+            std::cout << symbol;
+            set_color(color::reset);
 #else
-                attron(COLOR_PAIR(TAPE_CURSOR));
-                addch(tape[i]);
-                attroff(COLOR_PAIR(TAPE_CURSOR));
+            attron(COLOR_PAIR(TAPE_CURSOR));
+            addch(symbol);
+            attroff(COLOR_PAIR(TAPE_CURSOR));
 #endif
-            }
-            else
-            {
+        }
+        else
+        {
 #ifdef WIN32
-                std::cout << tape[i];
+            std::cout << symbol;
 #else
-                addch(tape[i]);
+            addch(symbol);
 #endif
-            }
+        }
+    }
 
-#ifndef WIN32 // Linux
-    refresh();
-#endif
+    // The arrows are enabled if there is more tape on that side
+    draw_tape_scrollers(frame.window_start == 0, frame.window_start + frame.window_length >= frame.tape_size);
 }
 
-bool TuringConsole::print_turing_code(std::ifstream& file)
+void TuringConsole::print_status(const MachineFrame& frame, bool paused)
 {
-    char c;
-    // TODO: cannot print past last line in ncurses/linux
+    std::string status;
+    if (frame.finished)
+        status = frame.result == StepResult::error ? std::string("Error: ") + frame.error : "Halted";
+    else
+        status = paused ? "Paused" : "Running";
 
-    set_position(code_start);
-    if (file.is_open())
-        while (file.good())
-        {
-            c = file.get();
+    char text[256];
+    std::snprintf(text, sizeof(text), "Step %llu   State %s   %s", frame.steps, frame.state, status.c_str());
+    std::string line = text;
+    if (frame.notice[0] != '\0')
+        line += std::string("   ") + frame.notice;
+    if (frame.dropped > 0)
+        line += "   (" + std::to_string(frame.dropped) + " frames not drawn)";
 
-#ifdef WIN32
-            // Comment
-            if (c == ';')
-                set_color(color::light_black_fg);
-            else if (c == '\n')
-                set_color(color::reset);
+    const coord status_start = { 5, (unsigned short)(code_start.y - 1) };
+    unsigned int available = width > (int)status_start.x ? width - status_start.x : 0;
+    if (line.size() > available)
+        line.resize(available);
 
-            std::cout << c;
+#ifdef WIN32
+    set_position(status_start);
+    std::cout << line << std::string(available - line.size(), ' ');
 #else
-            // Comment
-            if (c == ';')
-                attron(COLOR_PAIR(COMMENT_LINE));
-            else if (c == '\n')
-                attroff(COLOR_PAIR(COMMENT_LINE));
-
-            addch(c);
+    move(status_start.y, status_start.x);
+    clrtoeol();
+    addstr(line.c_str());
 #endif
-        }
-    else
+}
+
+bool TuringConsole::print_turing_code(std::ifstream& file)
+{
+    if (!file.is_open())
     {
         std::cerr << "Error opening file containing Turing instructions" << std::endl;
         return false;
     }
 
+    // Kept in memory so that highlighting and scrolling do not read the file again
+    code_lines.clear();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        code_lines.push_back(line);
+    }
+
     file.clear();
     file.seekg(0);
-#ifdef WIN32
-    set_color(color::reset);
-#else
-    attroff(COLOR_PAIR(COMMENT_LINE));
+
+    for (unsigned int row = 1; row <= code_rows(); row++)
+        draw_code_line(code_scroll + row);
+#ifndef WIN32 // Linux
     refresh();
 #endif
 
@@ -368,7 +357,15 @@ void TuringConsole::print_instructions()
     set_color(color::yellow_fg);
     std::cout << "F10";
     set_color(color::green_fg);
-    std::cout << " : Step";
+    std::cout << " : Step   ";
+    set_color(color::yellow_fg);
+    std::cout << "Space";
+    set_color(color::green_fg);
+    std::cout << " : Run/Pause   ";
+    set_color(color::yellow_fg);
+    std::cout << "q";
+    set_color(color::green_fg);
+    std::cout << " : Quit";
 
     set_color(color::reset);
 #else
@@ -391,10 +388,178 @@ void TuringConsole::print_instructions()
     attron(COLOR_PAIR(INSTRUCTION_KEY));
     addstr("F10");
     attron(COLOR_PAIR(INSTRUCTION_TXT));
-    addstr(" : Step");
-    
+    addstr(" : Step   ");
+    attron(COLOR_PAIR(INSTRUCTION_KEY));
+    addstr("Space");
+    attron(COLOR_PAIR(INSTRUCTION_TXT));
+    addstr(" : Run/Pause   ");
+    attron(COLOR_PAIR(INSTRUCTION_KEY));
+    addstr("q");
+    attron(COLOR_PAIR(INSTRUCTION_TXT));
+    addstr(" : Quit");
+
     attroff(COLOR_PAIR(INSTRUCTION_KEY));
     attroff(COLOR_PAIR(INSTRUCTION_TXT));
     refresh();
 #endif
-}
\ No newline at end of file
+}
+
+#ifndef WIN32 // Linux
+void TuringConsole::watch_code(const std::string& path)
+{
+    code_path = path;
+    code_watcher.reset(new FileWatcher{ path });
+}
+
+void TuringConsole::reload_code(MachineControl& control)
+{
+    // The file may be gone for a moment while an editor replaces it; the next save reloads it
+    std::ifstream file{ code_path };
+    if (!file.is_open())
+        return;
+    std::stringstream code;
+    code << file.rdbuf();
+
+    std::vector<std::string> old_lines = std::move(code_lines);
+    code_lines.clear();
+    std::istringstream lines{ code.str() };
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        code_lines.push_back(line);
+    }
+
+    // The file is now shorter than the part scrolled past; scrolling draws every line
+    if (code_scroll > 0 && code_scroll >= code_lines.size())
+        scroll_code(-(int)code_scroll);
+    else
+    {
+        // Only the lines that changed are drawn again
+        for (size_t i = 0; i < code_lines.size() || i < old_lines.size(); i++)
+            if (i >= code_lines.size() || i >= old_lines.size() || code_lines[i] != old_lines[i])
+                draw_code_line((unsigned int)i + 1);
+    }
+
+    // The machine parses the code between steps. Code it has not taken yet is out of date
+    delete control.reload.exchange(new std::string(code.str()), std::memory_order_acq_rel);
+}
+#endif
+
+enum class Key { none, tape_left, tape_right, code_up, code_down, step, pause, quit };
+
+// Waits a short time for a key, so that the caller draws about 60 times per second
+static Key read_key()
+{
+#ifdef WIN32
+    if (!_kbhit())
+    {
+        Sleep(16);
+        return Key::none;
+    }
+
+    int c = _getch();
+    // Arrows and function keys come as 2 codes
+    if (c == 0 || c == 224)
+        switch (_getch())
+        {
+        case 75: return Key::tape_left;
+        case 77: return Key::tape_right;
+        case 72: return Key::code_up;
+        case 80: return Key::code_down;
+        case 68: return Key::step;
+        default: return Key::none;
+        }
+#else
+    int c = getch();
+    switch (c)
+    {
+    case KEY_LEFT:  return Key::tape_left;
+    case KEY_RIGHT: return Key::tape_right;
+    case KEY_UP:    return Key::code_up;
+    case KEY_DOWN:  return Key::code_down;
+    case KEY_F(10): return Key::step;
+    default: break;
+    }
+#endif
+
+    if (c == ' ')
+        return Key::pause;
+    if (c == 'q' || c == 'Q')
+        return Key::quit;
+    return Key::none;
+}
+
+void TuringConsole::run(FrameBuffer& frames, MachineControl& control)
+{
+    control.tape_width.store(tape_display_width < MachineFrame::TAPE_WINDOW ? tape_display_width : MachineFrame::TAPE_WINDOW,
+                             std::memory_order_relaxed);
+#ifndef WIN32 // Linux
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    // getch() waits at most 16ms
+    timeout(16);
+#endif
+
+    MachineFrame frame{};
+    bool have_frame = false;
+
+    while (true)
+    {
+        // Only the newest frame is drawn, the ones before it are already out of date
+        const MachineFrame* latest = frames.take();
+        bool new_frame = latest != nullptr;
+        if (new_frame)
+            frame = *latest;
+
+        bool paused = control.paused.load(std::memory_order_relaxed);
+        if (new_frame)
+        {
+            have_frame = true;
+            set_tape_value(frame);
+            if (frame.line != current_code_line)
+            {
+                show_code_line(frame.line);
+                set_current_code_line(frame.line);
+            }
+        }
+        if (have_frame)
+            print_status(frame, paused);
+#ifndef WIN32 // Linux
+        if (code_watcher && code_watcher->changed())
+            reload_code(control);
+        refresh();
+#endif
+
+        switch (read_key())
+        {
+        case Key::quit:
+            control.quit.store(true, std::memory_order_relaxed);
+            return;
+        case Key::pause:
+            control.paused.store(!paused, std::memory_order_relaxed);
+            break;
+        case Key::step:
+            control.paused.store(true, std::memory_order_relaxed);
+            control.step_requests.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case Key::tape_left:
+            if (have_frame && frame.window_start > 0)
+                control.tape_scroll.fetch_sub(1, std::memory_order_relaxed);
+            break;
+        case Key::tape_right:
+            if (have_frame && frame.window_start + frame.window_length < frame.tape_size)
+                control.tape_scroll.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case Key::code_up:
+            scroll_code(-1);
+            break;
+        case Key::code_down:
+            scroll_code(1);
+            break;
+        case Key::none:
+            break;
+        }
+    }
+}
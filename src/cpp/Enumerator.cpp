@@ -0,0 +1,271 @@
+#include "Enumerator.h"
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <vector>
+using std::string;
+
+// Symbols in the order they get introduced. The first one is the blank
+static const char SYMBOLS[Enumerator::MAX_SYMBOLS + 1] = " 123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+Enumerator::Enumerator(unsigned int _states, unsigned int _symbols, unsigned long long _max_steps, std::ostream& _results)
+    : states(_states), symbols(_symbols), max_steps(_max_steps), min_steps(0), report(Report::halting), results(_results),
+      machines(0), halting(0), cyclers(0), escapees(0), undecided(0), longest_run(0)
+{
+}
+
+void Enumerator::run(unsigned int threads)
+{
+    struct Node
+    {
+        TuringProgram program;
+        TuringCore core;
+        unsigned int used_states;
+        unsigned int used_symbols;
+    };
+
+    if (threads == 0)
+        threads = 1;
+
+    // States are named after their index
+    TuringProgram root;
+    for (unsigned int i = 0; i < states; i++)
+        root.state_id(std::to_string(i));
+
+    // Expand the top of the tree breadth first until there is enough work to split between threads
+    std::deque<Node> frontier;
+    frontier.push_back(Node{ root, TuringCore{ "", 0 }, 1, 1 });
+    while (!frontier.empty() && frontier.size() < threads * 64)
+    {
+        Node node = std::move(frontier.front());
+        frontier.pop_front();
+
+        visit(node.program, node.core, node.used_states, node.used_symbols,
+              [&frontier](TuringProgram& program, const TuringCore& core, unsigned int used_states, unsigned int used_symbols)
+              {
+                  frontier.push_back(Node{ program, core, used_states, used_symbols });
+              });
+    }
+
+    std::atomic<size_t> next{ 0 };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+        workers.emplace_back([this, &frontier, &next]()
+                             {
+                                 for (size_t n = next++; n < frontier.size(); n = next++)
+                                     search(frontier[n].program, frontier[n].core, frontier[n].used_states, frontier[n].used_symbols);
+                             });
+    for (std::thread& worker : workers)
+        worker.join();
+
+    results.flush();
+}
+
+void Enumerator::search(TuringProgram& program, const TuringCore& core, unsigned int used_states, unsigned int used_symbols)
+{
+    visit(program, core, used_states, used_symbols,
+          [this](TuringProgram& child, const TuringCore& child_core, unsigned int child_states, unsigned int child_symbols)
+          {
+              search(child, child_core, child_states, child_symbols);
+          });
+}
+
+template <typename Callback>
+void Enumerator::visit(TuringProgram& program, TuringCore core, unsigned int used_states, unsigned int used_symbols, Callback child)
+{
+    Outcome outcome = simulate(program, core);
+    machines++;
+
+    switch (outcome)
+    {
+    case Outcome::halt:
+    {
+        halting++;
+        unsigned long long steps = core.get_steps();
+        unsigned long long longest = longest_run.load();
+        while (steps > longest && !longest_run.compare_exchange_weak(longest, steps))
+            ;
+
+        if (report != Report::undecided && steps >= min_steps)
+            write_result("halt", program, core);
+        break;
+    }
+    case Outcome::cycler:
+        cyclers++;
+        if (report == Report::all)
+            write_result("cycler", program, core);
+        return;
+    case Outcome::escapee:
+        escapees++;
+        if (report == Report::all)
+            write_result("escapee", program, core);
+        return;
+    case Outcome::undecided:
+        undecided++;
+        if (report != Report::halting)
+            write_result("undecided", program, core);
+        return;
+    }
+
+    // Defining the last transition would leave the machine with no way to halt
+    if (program.size() + 1 >= static_cast<size_t>(states) * symbols)
+        return;
+
+    // Fill in the transition the machine halted on
+    int state = core.get_state();
+    char symbol = core.get_tape()[core.get_position()];
+    // Only one new state/symbol can be introduced at a time (Tree Normal Form)
+    unsigned int state_limit = std::min(used_states + 1, states);
+    unsigned int symbol_limit = std::min(used_symbols + 1, symbols);
+
+    for (unsigned int new_state = 0; new_state < state_limit; new_state++)
+        for (unsigned int new_symbol = 0; new_symbol < symbol_limit; new_symbol++)
+            for (char move_direction : { 'l', 'r' })
+            {
+                program.add_instruction(state, symbol, SYMBOLS[new_symbol], move_direction, static_cast<int>(new_state));
+                child(program, core, std::max(used_states, new_state + 1), std::max(used_symbols, new_symbol + 1));
+                program.pop_instruction();
+            }
+}
+
+Enumerator::Outcome Enumerator::simulate(const TuringProgram& program, TuringCore& core) const
+{
+    // Configuration saved every power of two steps. Seeing it again means the machine loops forever
+    // (only transitions that are already defined were used to get back to it).
+    // The configuration is also compared relative to each end of the tape, to find cycles that drift along the tape.
+    int saved_state = core.get_state();
+    unsigned int saved_position = core.get_position();
+    string saved_tape = core.get_tape();
+    unsigned long long next_save = 1;
+
+    // Since the configuration was saved: how the tape grew, and the cells the head was on
+    // (as positions of the saved tape, so they can be before its start)
+    unsigned long long grown_left = 0;
+    bool grown_right = false;
+    long long lowest = saved_position, highest = saved_position;
+
+    for (unsigned long long n = 1; core.get_steps() < max_steps; n++)
+    {
+        // Generated machines never have syntax errors
+        if (core.step(program) != StepResult::ok)
+            return Outcome::halt;
+
+        const string& tape = core.get_tape();
+        unsigned int position = core.get_position();
+        StepEvent::Move move = core.last_event().move;
+
+        // Just stepped onto a blank cell at the edge of the tape
+        if (move == StepEvent::Move::grow_left && escapes(program, core.get_state(), false))
+            return Outcome::escapee;
+        if (move == StepEvent::Move::right && position == tape.size() - 1 && tape[position] == ' '
+            && escapes(program, core.get_state(), true))
+            return Outcome::escapee;
+
+        if (move == StepEvent::Move::grow_left)
+            grown_left++;
+        if (move == StepEvent::Move::grow_right)
+            grown_right = true;
+        long long saved_cell = static_cast<long long>(position) - static_cast<long long>(grown_left);
+        lowest = std::min(lowest, saved_cell);
+        highest = std::max(highest, saved_cell);
+
+        if (core.get_state() == saved_state)
+        {
+            if (position == saved_position && tape == saved_tape)
+                return Outcome::cycler;
+
+            // Everything the machine read since the configuration was saved, from that cell to the right end of
+            // the tape, is the same again at the same distance from the right end. It never reached the left end,
+            // so it will repeat the same steps further right forever.
+            auto read = static_cast<size_t>(saved_tape.size() - lowest);
+            if (grown_left == 0 && lowest > 0 && tape.size() - position == saved_tape.size() - saved_position
+                && tape.compare(tape.size() - read, read, saved_tape, saved_tape.size() - read, read) == 0)
+                return Outcome::cycler;
+
+            // Same, relative to the left end
+            read = static_cast<size_t>(highest + 1);
+            if (!grown_right && highest < static_cast<long long>(saved_tape.size()) - 1 && position == saved_position
+                && tape.compare(0, read, saved_tape, 0, read) == 0)
+                return Outcome::cycler;
+        }
+
+        if (n == next_save)
+        {
+            saved_state = core.get_state();
+            saved_position = position;
+            saved_tape = tape;
+            next_save *= 2;
+            grown_left = 0;
+            grown_right = false;
+            lowest = highest = position;
+        }
+    }
+
+    return Outcome::undecided;
+}
+
+bool Enumerator::escapes(const TuringProgram& program, int state, bool right) const
+{
+    // The head is on a blank with only blanks past it. As long as the machine keeps moving outwards
+    // it only ever reads blanks, so being back at the edge on a blank in the same state means it
+    // will keep doing the same thing forever. Run it on a tape of its own to find out.
+    TuringCore local{ " ", state };
+    std::vector<bool> seen(states, false);
+
+    // Moving right off the edge takes 2 steps (the head stays on the last cell when the tape grows)
+    for (unsigned int i = 0; i <= 2 * states + 2; i++)
+    {
+        const string& tape = local.get_tape();
+        unsigned int position = local.get_position();
+        bool at_edge = right ? position == tape.size() - 1 : position == 0;
+
+        if (at_edge && tape[position] == ' ')
+        {
+            if (seen[local.get_state()])
+                return true;
+            seen[local.get_state()] = true;
+        }
+
+        if (local.step(program) != StepResult::ok)
+            return false;
+
+        // Going back towards the rest of the tape
+        StepEvent::Move move = local.last_event().move;
+        if (right && (move == StepEvent::Move::left || move == StepEvent::Move::grow_left))
+            return false;
+        if (!right && (move == StepEvent::Move::right || move == StepEvent::Move::grow_right))
+            return false;
+    }
+
+    return false;
+}
+
+void Enumerator::write_result(const char* status, const TuringProgram& program, const TuringCore& core)
+{
+    // <status> <steps> <non-blank symbols> <instructions separated by |>
+    const string& tape = core.get_tape();
+    size_t non_blank = tape.size() - std::count(tape.begin(), tape.end(), ' ');
+
+    string code = program.to_string();
+    string line = string(status) + ' ' + std::to_string(core.get_steps()) + ' ' + std::to_string(non_blank) + ' ';
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        if (code[i] != '\n')
+            line += code[i];
+        else if (i + 1 < code.size())
+            line += " | ";
+    }
+    line += '\n';
+
+    std::lock_guard<std::mutex> lock{ results_mutex };
+    results << line;
+}
+
+void Enumerator::print_summary(std::ostream& out) const
+{
+    out << "Machines:  " << machines << '\n'
+        << "Halting:   " << halting << " (longest run: " << longest_run << " steps)\n"
+        << "Cyclers:   " << cyclers << '\n'
+        << "Escapees:  " << escapees << '\n'
+        << "Undecided: " << undecided << std::endl;
+}
@@ -0,0 +1,59 @@
+#include "FileWatcher.h"
+
+#ifndef WIN32 // Linux
+
+#include <iostream>
+#include <sys/inotify.h>
+#include <unistd.h>
+using std::string;
+
+FileWatcher::FileWatcher(const string& path)
+    : inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    name = slash == string::npos ? path : path.substr(slash + 1);
+
+    if (inotify < 0)
+    {
+        std::cerr << "Error watching " << path << ": could not start inotify" << std::endl;
+        return;
+    }
+    // Written in place, or replaced by a new file
+    if (inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cerr << "Error watching " << path << ": could not watch " << directory << std::endl;
+        close(inotify);
+        inotify = -1;
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (inotify >= 0)
+        close(inotify);
+}
+
+bool FileWatcher::changed()
+{
+    if (inotify < 0)
+        return false;
+
+    bool found = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+
+    // Saving a file usually causes several events; they are all read at once
+    while ((length = read(inotify, buffer, sizeof(buffer))) > 0)
+        for (ssize_t i = 0; i < length;)
+        {
+            auto event = reinterpret_cast<const inotify_event*>(buffer + i);
+            if (event->len > 0 && name == event->name)
+                found = true;
+            i += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+
+    return found;
+}
+
+#endif
@@ -0,0 +1,487 @@
+#include "Fuzzer.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include "TuringProgram.h"
+#include "Optimizer.h"
+#include "Accelerator.h"
+#include "Fnv1a.h"
+using std::string;
+
+// Runs a program that has already been parsed. final_state is set to the state the core ended in
+static FuzzOutcome run_core(const TuringProgram& program, int initial_state, const string& input,
+                            unsigned long long max_steps, int& final_state, BlockAccelerator* accelerator = nullptr)
+{
+    TuringCore core{ input, initial_state };
+    StepResult result = StepResult::ok;
+    while (core.get_steps() < max_steps
+           && (result = accelerator ? accelerator->step(core, max_steps) : core.step(program)) == StepResult::ok)
+        ;
+
+    final_state = core.get_state();
+    return FuzzOutcome{ result, core.get_steps(), core.get_tape(), core.get_position(),
+                        { program.state_name(core.get_state()) },
+                        result == StepResult::error ? core.error_message() : string{} };
+}
+
+// A few random changes to the lines, for update_lines() to undo. Seeded from the code,
+// so that the same code always gets the same changes (minimizing depends on it)
+static std::vector<string> edit_lines(std::vector<string> lines, const string& code)
+{
+    static const std::array<const char*, 6> new_lines = { "0 1 1 r 1", "* * * l *", "1 _ X * a", "", "; comment", "a 11 1 r 0" };
+
+    Fnv1a h;
+    h.add(code.data(), code.size());
+    std::mt19937_64 random{ h.value() };
+    // A new line, or a copy of one of the program
+    auto pick_line = [&]() { return random() % 2 == 0 || lines.empty() ? string{ new_lines[random() % new_lines.size()] }
+                                                                      : lines[random() % lines.size()]; };
+
+    size_t edits = 1 + random() % 3;
+    for (size_t i = 0; i < edits; i++)
+    {
+        auto at = static_cast<long>(random() % (lines.size() + 1));
+        switch (random() % 3)
+        {
+        case 0:
+            if (at < static_cast<long>(lines.size()))
+                lines.erase(lines.begin() + at);
+            break;
+        case 1:
+            lines.insert(lines.begin() + at, pick_line());
+            break;
+        default:
+            if (at < static_cast<long>(lines.size()))
+                lines[at] = pick_line();
+            break;
+        }
+    }
+    return lines;
+}
+
+DifferentialFuzzer::DifferentialFuzzer(unsigned long long seed, unsigned long long _max_steps)
+    : random(seed), max_steps(_max_steps)
+{
+    // Scanning the lines of the parsed program
+    add_engine("scan", [](const string& code, const string& input, const string& initial_state, unsigned long long steps)
+    {
+        std::istringstream source{ code };
+        TuringProgram program{ source };
+        int state = program.state_id(initial_state);
+        return run_core(program, state, input, steps, state);
+    });
+
+    // Dense table of every state and symbol
+    add_engine("table", [](const string& code, const string& input, const string& initial_state, unsigned long long steps)
+    {
+        std::istringstream source{ code };
+        TuringProgram program{ source };
+        int state = program.state_id(initial_state);
+        program.expand_wildcards();
+        return run_core(program, state, input, steps, state);
+    });
+
+    // Small blocks and cache, so that random programs on short tapes hit it and entries get replaced
+    add_engine("blocks", [](const string& code, const string& input, const string& initial_state, unsigned long long steps)
+    {
+        std::istringstream source{ code };
+        TuringProgram program{ source };
+        int state = program.state_id(initial_state);
+        program.expand_wildcards();
+        BlockAccelerator accelerator{ program, 2, 16 };
+        return run_core(program, state, input, steps, state, &accelerator);
+    });
+
+    // Table of a different version of the code, patched by update_lines() the way a reload in the console does it
+    add_engine("patched", [](const string& code, const string& input, const string& initial_state, unsigned long long steps)
+    {
+        std::istringstream source{ code };
+        std::vector<string> lines = TuringProgram::read_lines(source);
+        std::vector<string> edited = edit_lines(lines, code);
+
+        TuringProgram program{ edited };
+        int state = program.state_id(initial_state);
+        program.expand_wildcards();
+        program.update_lines(edited, lines);
+        return run_core(program, state, input, steps, state);
+    });
+
+    add_engine("optimized", [](const string& code, const string& input, const string& initial_state, unsigned long long steps)
+    {
+        std::istringstream source{ code };
+        TuringProgram program{ source };
+        program.state_id(initial_state);
+        ProgramOptimizer optimizer{ program, initial_state };
+
+        int final_state;
+        FuzzOutcome outcome = run_core(optimizer.get_program(), optimizer.get_initial_state(), input, steps, final_state);
+
+        // Every original state that was merged into the final state
+        outcome.states.clear();
+        for (size_t state = 0; state < program.state_count(); state++)
+            if (optimizer.map_state(static_cast<int>(state)) == final_state)
+                outcome.states.push_back(program.state_name(static_cast<int>(state)));
+        return outcome;
+    });
+}
+
+void DifferentialFuzzer::add_engine(const string& name, Engine engine)
+{
+    engines.push_back(NamedEngine{ name, std::move(engine) });
+}
+
+// One step of the original interpreter, kept as it was (without the console output) so that every
+// engine can be checked against it
+static StepResult reference_step(std::istream& instructions, string& tape, unsigned int& position,
+                                 string& current_state, string& error)
+{
+    // <state> <symbol> <new_symbol> <r | l> <new_state>
+
+    // First line is line 1
+    unsigned int line_num = 0;
+
+    // look for a matching current_symbol in a matching current_state
+    while (instructions.good())
+    {
+        string line;
+        std::getline(instructions, line);
+        // First line is line 1
+        line_num++;
+
+        std::array<string, 5> read_order = {
+            string{}, // state
+            string{}, // symbol
+            string{}, // new_symbol
+            string{}, // move_direction (r | l)
+            string{}  // new_state
+        };
+        unsigned short read_from = 0;
+        bool reading = false;
+
+        // assign values
+        for (char c : line)
+        {
+            // comment, can be skipped
+            if (c == ';')
+                break;
+
+            // whitespace used as separator
+            if (c == ' ' && reading)
+            {
+                reading = false;
+                // move on to reading symbol
+                if (read_from < read_order.size() - 1)
+                    read_from++;
+                // done reading state and symbol
+                else if (read_from >= read_order.size() - 1)
+                    break;
+                continue;
+            }
+            else if (c != ' ' && reading)
+            {
+                read_order[read_from] += c;
+            }
+            else if (c != ' ' && !reading)
+            {
+                reading = true;
+                read_order[read_from] += c;
+            }
+        }
+
+        // Ignore this line if state does not match; "*" is wildcard
+        if (read_order[0] == current_state || read_order[0] == "*")
+        {
+            // Current_Symbol
+            if (read_order[1].size() > 1)
+            {
+                error = "Syntax Error (line " + std::to_string(line_num) + "): Symbol must only be 1 character long";
+                return StepResult::error;
+            }
+            else if (read_order[1].empty())
+            {
+                error = "Error (line " + std::to_string(line_num) + "): Could not find Symbol character";
+                return StepResult::error;
+            }
+            // New_Symbol
+            if (read_order[2].size() > 1)
+            {
+                error = "Syntax Error (line " + std::to_string(line_num) + "): New_Symbol must only be 1 character long";
+                return StepResult::error;
+            }
+            else if (read_order[2].empty())
+            {
+                error = "Error (line " + std::to_string(line_num) + "): Could not find New_Symbol character";
+                return StepResult::error;
+            }
+            // Move_Direction
+            if (read_order[3].size() > 1)
+            {
+                error = "Syntax Error (line " + std::to_string(line_num) + "): Move_Direction must only be 1 character long";
+                return StepResult::error;
+            }
+            else if (read_order[3].empty())
+            {
+                error = "Error (line " + std::to_string(line_num) + "): Could not find Move_Direction character";
+                return StepResult::error;
+            }
+
+            string& state       = read_order[0];
+            char symbol         = read_order[1][0];
+            char new_symbol     = read_order[2][0];
+            char move_direction = std::tolower(read_order[3][0]);
+            string& new_state   = read_order[4];
+            (void)state;
+            // _ represents space
+            if (symbol == '_')
+                symbol = ' ';
+            if (new_symbol == '_')
+                new_symbol = ' ';
+
+            // State and Symbol match current
+            if (symbol == tape[position] || symbol == '*')
+            {
+                // * is no change; no need to write new_symbol if it's the same as old
+                if (new_symbol != '*' && new_symbol != tape[position])
+                    tape[position] = new_symbol;
+
+                // Move left or right; * is no change
+                if (move_direction != '*')
+                {
+                    if (move_direction == 'l' && position == 0)
+                        tape.insert(tape.begin(), ' ');
+                    else if (move_direction == 'r' && position >= tape.size() - 1)
+                        tape.append(" ");
+                    else if (move_direction == 'l')
+                        position--;
+                    else if (move_direction == 'r')
+                        position++;
+                    // Direction is not l or r
+                    else
+                    {
+                        error = "Syntax Error (line " + std::to_string(line_num) + "): Move_Direction must be either r or l";
+                        return StepResult::error;
+                    }
+                }
+
+                // * is no change
+                if (new_state != "*")
+                    current_state = new_state;
+
+                // Step done successfully
+                return StepResult::ok;
+            }
+        }
+    }
+
+    return StepResult::halt;
+}
+
+FuzzOutcome DifferentialFuzzer::reference(const string& code, const string& input, const string& initial_state,
+                                          unsigned long long max_steps)
+{
+    FuzzOutcome outcome{ StepResult::ok, 0, input.empty() ? " " : input, 0, { initial_state }, string{} };
+
+    while (outcome.steps < max_steps)
+    {
+        // The original read the program file again, from the start, on every step
+        std::istringstream instructions{ code };
+        outcome.result = reference_step(instructions, outcome.tape, outcome.position, outcome.states[0], outcome.error);
+        if (outcome.result != StepResult::ok)
+            break;
+        outcome.steps++;
+    }
+
+    return outcome;
+}
+
+string DifferentialFuzzer::compare(const string& code, const string& input, const string& initial_state) const
+{
+    FuzzOutcome expected = reference(code, input, initial_state, max_steps);
+    std::ostringstream differences;
+
+    for (const NamedEngine& engine : engines)
+    {
+        FuzzOutcome actual = engine.engine(code, input, initial_state, max_steps);
+        std::ostringstream engine_differences;
+
+        // Engines that execute several steps at once can stop past the step limit, so the reference is run to the same step
+        const FuzzOutcome* compared = &expected;
+        FuzzOutcome extended;
+        if (expected.result == StepResult::ok && actual.result == StepResult::ok && actual.steps > expected.steps)
+        {
+            extended = reference(code, input, initial_state, actual.steps);
+            compared = &extended;
+        }
+
+        if (actual.result != compared->result)
+            engine_differences << "  result:   " << result_name(compared->result) << " | " << result_name(actual.result) << '\n';
+        if (actual.steps != compared->steps)
+            engine_differences << "  steps:    " << compared->steps << " | " << actual.steps << '\n';
+        if (actual.tape != compared->tape)
+            engine_differences << "  tape:     \"" << compared->tape << "\" | \"" << actual.tape << "\"\n";
+        if (actual.position != compared->position)
+            engine_differences << "  position: " << compared->position << " | " << actual.position << '\n';
+        if (std::find(actual.states.begin(), actual.states.end(), compared->states[0]) == actual.states.end())
+            engine_differences << "  state:    " << compared->states[0] << " | " << (actual.states.empty() ? string{} : actual.states[0]) << '\n';
+        if (actual.error != compared->error)
+            engine_differences << "  error:    " << compared->error << " | " << actual.error << '\n';
+
+        if (!engine_differences.str().empty())
+            differences << engine.name << " (reference | " << engine.name << "):\n" << engine_differences.str();
+    }
+
+    return differences.str();
+}
+
+string DifferentialFuzzer::random_program()
+{
+    static const std::array<const char*, 5> states      = { "0", "1", "2", "a", "*" };
+    static const std::array<const char*, 5> symbols     = { "_", "1", "0", "X", "*" };
+    static const std::array<const char*, 5> directions  = { "r", "l", "*", "R", "L" };
+    // Mistakes that the interpreter only reports once it reaches the line
+    static const std::array<const char*, 4> bad_symbols = { "11", "", "__", "x" };
+
+    auto pick = [this](size_t count) { return static_cast<size_t>(random() % count); };
+    auto chance = [this](unsigned int percent) { return random() % 100 < percent; };
+
+    string code;
+    size_t lines = 1 + pick(8);
+    for (size_t i = 0; i < lines; i++)
+    {
+        if (chance(5))
+        {
+            code += "\n";
+            continue;
+        }
+        if (chance(4))
+        {
+            code += "; comment\n";
+            continue;
+        }
+
+        std::vector<string> tokens = {
+            states[pick(states.size())],
+            chance(3) ? bad_symbols[pick(2)] : symbols[pick(symbols.size())],
+            chance(3) ? bad_symbols[pick(2)] : symbols[pick(symbols.size())],
+            chance(3) ? bad_symbols[pick(bad_symbols.size())] : directions[pick(directions.size())],
+            states[pick(states.size())],
+        };
+        // Missing or extra tokens
+        if (chance(4))
+            tokens.resize(pick(tokens.size()));
+        else if (chance(3))
+            tokens.push_back("extra");
+
+        string line;
+        for (const string& token : tokens)
+        {
+            if (token.empty())
+                continue;
+            line += chance(10) ? "  " : " ";
+            line += token;
+        }
+        if (chance(10))
+            line += " ; comment";
+        code += line + '\n';
+    }
+
+    // Sometimes no newline at the end of the file
+    if (chance(30) && !code.empty())
+        code.pop_back();
+    return code;
+}
+
+string DifferentialFuzzer::random_input()
+{
+    static const char symbols[] = { '1', '0', 'X', '_', ' ', '*' };
+
+    string input;
+    size_t length = random() % 7;
+    for (size_t i = 0; i < length; i++)
+        input += symbols[random() % sizeof(symbols)];
+    return input;
+}
+
+string DifferentialFuzzer::random_state()
+{
+    // "b" is not in any program
+    static const std::array<const char*, 4> states = { "0", "1", "a", "b" };
+    return states[random() % states.size()];
+}
+
+bool DifferentialFuzzer::run(unsigned long long iterations, const string& reproducer_path, std::ostream& out)
+{
+    for (unsigned long long i = 0; i < iterations; i++)
+    {
+        string code = random_program();
+        string input = random_input();
+        string initial_state = random_state();
+
+        string differences = compare(code, input, initial_state);
+        if (differences.empty())
+            continue;
+
+        out << "Mismatch after " << i + 1 << " programs. Minimizing..." << std::endl;
+
+        // Remove lines and input symbols one at a time, as long as the engines still disagree
+        std::vector<string> lines;
+        std::istringstream source{ code };
+        for (string line; std::getline(source, line); )
+            lines.push_back(line);
+        auto join = [](const std::vector<string>& code_lines) {
+            string joined;
+            for (const string& line : code_lines)
+                joined += line + '\n';
+            return joined;
+        };
+
+        // Joining the lines back adds a newline at the end
+        if (!compare(join(lines), input, initial_state).empty())
+        {
+            for (bool changed = true; changed; )
+            {
+                changed = false;
+
+                for (size_t line = 0; line < lines.size(); )
+                {
+                    std::vector<string> fewer = lines;
+                    fewer.erase(fewer.begin() + static_cast<long>(line));
+                    if (!compare(join(fewer), input, initial_state).empty())
+                    {
+                        lines = fewer;
+                        changed = true;
+                    }
+                    else
+                        line++;
+                }
+
+                for (size_t symbol = 0; symbol < input.size(); )
+                {
+                    string shorter = input;
+                    shorter.erase(symbol, 1);
+                    if (!compare(join(lines), shorter, initial_state).empty())
+                    {
+                        input = shorter;
+                        changed = true;
+                    }
+                    else
+                        symbol++;
+                }
+            }
+            code = join(lines);
+        }
+
+        std::ofstream reproducer{ reproducer_path, std::ios::binary };
+        reproducer << code;
+
+        out << "Program written to " << reproducer_path << '\n'
+            << "Reproduce with: -f " << reproducer_path << " -s \"" << initial_state << "\" -i \"" << input << "\"\n"
+            << compare(code, input, initial_state) << std::flush;
+        return false;
+    }
+
+    out << "All engines matched the reference on " << iterations << " programs" << std::endl;
+    return true;
+}
@@ -0,0 +1,329 @@
+#include "Optimizer.h"
+#include <map>
+#include <queue>
+#include "TuringCore.h"
+using std::string;
+
+// State that is not in any group yet
+static const int NO_GROUP = -1;
+
+ProgramOptimizer::ProgramOptimizer(const TuringProgram& _original, const string& initial_state)
+    : original(_original), other_symbol(0), merged_states(0), fused_instructions(0), dropped_lines(0)
+{
+    original_initial_state = original.state_id(initial_state);
+
+    // Symbols that can be read or written. All other symbols behave the same
+    bool used[256] = {};
+    used[static_cast<unsigned char>(' ')] = true;
+    for (const TuringInstruction& instruction : original.get_instructions())
+        if (instruction.error.empty())
+        {
+            if (instruction.symbol != '*')
+                used[static_cast<unsigned char>(instruction.symbol)] = true;
+            if (instruction.new_symbol != '*')
+                used[static_cast<unsigned char>(instruction.new_symbol)] = true;
+        }
+    for (unsigned int symbol = 0; symbol < 256; symbol++)
+        if (used[symbol])
+            alphabet.push_back(static_cast<char>(symbol));
+    for (unsigned int symbol = 1; symbol < 256 && other_symbol == 0; symbol++)
+        if (!used[symbol])
+            other_symbol = static_cast<char>(symbol);
+
+    // Symbols a transition is found for
+    std::vector<char> symbols = alphabet;
+    if (other_symbol != 0)
+        symbols.push_back(other_symbol);
+
+    // Find the transitions of every state reachable from the initial state
+    size_t state_count = original.state_count();
+    std::vector<std::vector<Transition>> transitions(state_count);
+    std::vector<bool> reachable(state_count, false);
+    std::vector<bool> used_lines(original.size() + 1, false);
+    // Reachable states in the order they were found
+    std::vector<int> order;
+
+    std::queue<int> pending;
+    pending.push(original_initial_state);
+    reachable[original_initial_state] = true;
+    while (!pending.empty())
+    {
+        int state = pending.front();
+        pending.pop();
+        order.push_back(state);
+
+        for (char symbol : symbols)
+        {
+            Transition t = transition(state, symbol, used_lines);
+            if (!t.halt && t.instruction.error.empty() && !reachable[t.instruction.new_state])
+            {
+                reachable[t.instruction.new_state] = true;
+                pending.push(t.instruction.new_state);
+            }
+            transitions[state].push_back(std::move(t));
+        }
+    }
+
+    // Merge equivalent states: start by grouping the states whose transitions write and move the same way,
+    // then keep splitting groups whose states go to different groups until nothing changes.
+    std::vector<int> group(state_count, NO_GROUP);
+    size_t group_count = 0;
+    for (size_t round = 0; ; round++)
+    {
+        std::map<string, int> signatures;
+        std::vector<int> next_group(state_count, NO_GROUP);
+
+        for (int state : order)
+        {
+            string signature = round == 0 ? string{} : std::to_string(group[state]) + '/';
+            for (const Transition& t : transitions[state])
+            {
+                if (t.halt)
+                    signature += "h";
+                else if (!t.instruction.error.empty())
+                    signature += "e" + t.instruction.error;
+                else if (round == 0)
+                {
+                    signature += string{ t.instruction.new_symbol, t.instruction.move_direction } + std::to_string(t.instruction.steps);
+                    // An invalid direction is reported with the line it is on, so it only behaves the same on the same line
+                    char direction = t.instruction.move_direction;
+                    if (direction != 'l' && direction != 'r' && direction != '*')
+                        signature += '@' + std::to_string(t.instruction.line);
+                }
+                else
+                    signature += std::to_string(group[t.instruction.new_state]);
+                signature += '|';
+            }
+
+            auto found = signatures.emplace(signature, static_cast<int>(signatures.size()));
+            next_group[state] = found.first->second;
+        }
+
+        group = next_group;
+        if (signatures.size() == group_count)
+            break;
+        group_count = signatures.size();
+    }
+
+    // Groups are numbered in the order their first state was found, so the initial state is in group 0.
+    // Each group becomes a state named after its first state
+    std::vector<int> representative(group_count, NO_GROUP);
+    for (int state : order)
+        if (representative[group[state]] == NO_GROUP)
+            representative[group[state]] = state;
+    for (int state : representative)
+        optimized.state_id(original.state_name(state));
+
+    state_map.assign(state_count, TuringProgram::WILDCARD);
+    for (int state : order)
+        state_map[state] = group[state];
+    optimized_initial_state = state_map[original_initial_state];
+    merged_states = static_cast<unsigned int>(order.size() - group_count);
+
+    // Instructions of the optimized program, and which state and symbol they are for
+    struct Entry
+    {
+        int state;
+        char symbol;
+        int instruction;
+    };
+    std::vector<Entry> entries;
+
+    for (size_t g = 0; g < group_count; g++)
+        for (const Transition& t : transitions[representative[g]])
+        {
+            if (t.halt)
+                continue;
+
+            TuringInstruction instruction = t.instruction;
+            char symbol = instruction.symbol == '*' ? other_symbol : instruction.symbol;
+            instruction.state = static_cast<int>(g);
+            if (instruction.error.empty())
+                instruction.new_state = group[instruction.new_state];
+            if (instruction.steps > 1)
+                fused_instructions++;
+
+            entries.push_back(Entry{ static_cast<int>(g), symbol, static_cast<int>(optimized.size()) });
+            optimized.add_instruction(instruction);
+        }
+
+    // The table has to be filled after adding every instruction
+    for (const Entry& entry : entries)
+    {
+        if (entry.symbol != other_symbol || other_symbol == 0)
+        {
+            optimized.set_transition(entry.state, entry.symbol, entry.instruction);
+            continue;
+        }
+
+        for (unsigned int symbol = 0; symbol < 256; symbol++)
+            if (!used[symbol])
+                optimized.set_transition(entry.state, static_cast<char>(symbol), entry.instruction);
+    }
+    // Make sure there is a table even if every state halts right away
+    if (!optimized.has_table())
+        optimized.expand_wildcards();
+
+    // Lines that are not blank or comments, but are never executed
+    for (const TuringInstruction& instruction : original.get_instructions())
+        if ((instruction.state == TuringProgram::WILDCARD || !original.state_name(instruction.state).empty())
+            && !used_lines[instruction.line])
+            dropped_lines++;
+}
+
+ProgramOptimizer::Transition ProgramOptimizer::transition(int state, char symbol, std::vector<bool>& used_lines) const
+{
+    bool other = symbol == other_symbol && other_symbol != 0;
+
+    const TuringInstruction* first = original.match(state, symbol);
+    if (first == nullptr)
+        return Transition{ true, TuringInstruction{} };
+    used_lines[first->line] = true;
+
+    Transition single{ false, *first };
+    TuringInstruction& instruction = single.instruction;
+    instruction.state = state;
+    // * stands for every symbol that does not appear in the program
+    instruction.symbol = other ? '*' : symbol;
+    if (!first->error.empty())
+        return single;
+
+    if (instruction.new_state == TuringProgram::WILDCARD)
+        instruction.new_state = state;
+    // Symbol under the head after writing; * while it is still the symbol that was read
+    char current = first->new_symbol == '*' ? instruction.symbol : first->new_symbol;
+    instruction.new_symbol = current;
+
+    // Keep executing instructions while the head does not move. The state and symbol under the head
+    // are known, so the whole chain does the same every time it is executed
+    Transition fused = single;
+    TuringInstruction& chain = fused.instruction;
+    // Going through more instructions than there are states and symbols means it never moves again
+    size_t limit = original.state_count() * (alphabet.size() + 1);
+
+    while (chain.move_direction == '*')
+    {
+        const TuringInstruction* next = original.match(chain.new_state, current == '*' ? symbol : current);
+        // Stop before halting or errors, so that they happen in the next step, same as in the original
+        if (next == nullptr || !next->error.empty()
+            || (next->move_direction != '*' && next->move_direction != 'l' && next->move_direction != 'r'))
+            break;
+        if (chain.steps > limit)
+            return single;
+
+        used_lines[next->line] = true;
+        if (next->new_symbol != '*')
+            current = next->new_symbol;
+        chain.new_symbol = current;
+        chain.move_direction = next->move_direction;
+        if (next->new_state != TuringProgram::WILDCARD)
+            chain.new_state = next->new_state;
+        chain.steps++;
+    }
+
+    return fused;
+}
+
+string ProgramOptimizer::dump() const
+{
+    string code = "; Optimized: " + std::to_string(merged_states) + " states merged, "
+                + std::to_string(fused_instructions) + " instructions fused, "
+                + std::to_string(dropped_lines) + " lines dropped\n";
+
+    auto symbol_name = [](char symbol) { return symbol == ' ' ? '_' : symbol; };
+
+    for (size_t state = 0; state < optimized.state_count(); state++)
+    {
+        const string& name = optimized.state_name(static_cast<int>(state));
+        bool other_applies = other_symbol != 0 && optimized.match(static_cast<int>(state), other_symbol) != nullptr;
+
+        std::vector<char> symbols = alphabet;
+        if (other_symbol != 0)
+            symbols.push_back(other_symbol);
+
+        for (char symbol : symbols)
+        {
+            const TuringInstruction* instruction = optimized.match(static_cast<int>(state), symbol);
+            bool other = symbol == other_symbol;
+
+            if (instruction == nullptr)
+            {
+                // Only worth showing if a wildcard line would make it look like it does not halt
+                if (!other && other_applies)
+                    code += "; " + name + ' ' + symbol_name(symbol) + " halts\n";
+                continue;
+            }
+            if (!instruction->error.empty())
+            {
+                code += "; " + name + ' ' + (other ? '*' : symbol_name(symbol)) + ": " + instruction->error + '\n';
+                continue;
+            }
+
+            code += name + ' ' + (other ? '*' : symbol_name(symbol)) + ' ' + symbol_name(instruction->new_symbol) + ' '
+                  + instruction->move_direction + ' ' + optimized.state_name(instruction->new_state)
+                  + " ; line " + std::to_string(instruction->line);
+            if (instruction->steps > 1)
+                code += ", " + std::to_string(instruction->steps) + " steps";
+            code += '\n';
+        }
+    }
+
+    return code;
+}
+
+bool ProgramOptimizer::check_equivalence(const string& input, unsigned long long max_steps, std::ostream& out) const
+{
+    TuringCore fast{ input, optimized_initial_state };
+    StepResult fast_result = StepResult::ok;
+    while (fast.get_steps() < max_steps && (fast_result = fast.step(optimized)) == StepResult::ok)
+        ;
+
+    // A fused instruction can take the optimized program past max_steps, so the original is run to the same step
+    unsigned long long reference_steps = fast_result == StepResult::ok ? fast.get_steps() : max_steps;
+    TuringCore reference{ input, original_initial_state };
+    StepResult reference_result = StepResult::ok;
+    while (reference.get_steps() < reference_steps && (reference_result = reference.step(original)) == StepResult::ok)
+        ;
+
+    bool equivalent = true;
+    if (reference_result != fast_result)
+    {
+        out << "Result:   " << result_name(reference_result) << " | optimized: " << result_name(fast_result) << '\n';
+        equivalent = false;
+    }
+    else
+    {
+        if (reference.get_steps() != fast.get_steps())
+        {
+            out << "Steps:    " << reference.get_steps() << " | optimized: " << fast.get_steps() << '\n';
+            equivalent = false;
+        }
+        if (reference.get_tape() != fast.get_tape())
+        {
+            out << "Tape:     \"" << reference.get_tape() << "\" | optimized: \"" << fast.get_tape() << "\"\n";
+            equivalent = false;
+        }
+        if (reference.get_position() != fast.get_position())
+        {
+            out << "Position: " << reference.get_position() << " | optimized: " << fast.get_position() << '\n';
+            equivalent = false;
+        }
+        if (map_state(reference.get_state()) != fast.get_state())
+        {
+            out << "State:    " << original.state_name(reference.get_state())
+                << " | optimized: " << optimized.state_name(fast.get_state()) << '\n';
+            equivalent = false;
+        }
+        if (reference_result == StepResult::error && reference.error_message() != fast.error_message())
+        {
+            out << "Error:    " << reference.error_message() << " | optimized: " << fast.error_message() << '\n';
+            equivalent = false;
+        }
+    }
+
+    if (equivalent)
+        out << "Equivalent: " << result_name(reference_result) << " after " << reference.get_steps() << " steps" << std::endl;
+    else
+        out.flush();
+    return equivalent;
+}
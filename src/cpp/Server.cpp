@@ -0,0 +1,412 @@
+#include "Server.h"
+
+#ifndef WIN32 // Linux
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "TuringCore.h"
+#include "Fnv1a.h"
+using std::string;
+
+// Steps a request may run for if it does not give max-steps
+static const unsigned long long DEFAULT_MAX_STEPS = 1000000;
+// Largest program a request may send, in bytes
+static const size_t MAX_PROGRAM_SIZE = 1 << 20;
+// A connection that sends nothing for this long (with none of its requests running) is closed
+static const time_t IDLE_TIMEOUT_SECONDS = 30;
+// Requests of one connection that can be queued or running at the same time
+static const unsigned int MAX_PENDING_REQUESTS = 64;
+
+ProgramCache::ProgramCache(size_t _capacity)
+    : capacity(_capacity == 0 ? 1 : _capacity), hits(0), misses(0)
+{
+}
+
+uint64_t ProgramCache::hash(const string& code)
+{
+    Fnv1a h;
+    h.add(code.data(), code.size());
+    return h.value();
+}
+
+std::shared_ptr<const TuringProgram> ProgramCache::get(const string& code)
+{
+    uint64_t key = hash(code);
+
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        auto found = index.find(key);
+        if (found != index.end() && found->second->code == code)
+        {
+            hits++;
+            // Move to the front
+            entries.splice(entries.begin(), entries, found->second);
+            return found->second->program;
+        }
+    }
+
+    // Parse without holding the lock, so that other requests are not blocked
+    misses++;
+    std::istringstream source{ code };
+    auto parsed = std::make_shared<TuringProgram>(source);
+    parsed->expand_wildcards();
+    std::shared_ptr<const TuringProgram> program = parsed;
+
+    std::lock_guard<std::mutex> lock{ mutex };
+    auto found = index.find(key);
+    if (found != index.end())
+    {
+        entries.erase(found->second);
+        index.erase(found);
+    }
+
+    entries.push_front(Entry{ key, code, program });
+    index[key] = entries.begin();
+
+    if (entries.size() > capacity)
+    {
+        index.erase(entries.back().hash);
+        entries.pop_back();
+    }
+
+    return program;
+}
+
+size_t ProgramCache::size()
+{
+    std::lock_guard<std::mutex> lock{ mutex };
+    return entries.size();
+}
+
+
+// Buffered reading from a connection
+class ConnectionReader
+{
+public:
+    explicit ConnectionReader(int _connection) : connection(_connection), start(0) {}
+
+    // Reads up to '\n' (not included). Returns false if the connection was closed
+    bool read_line(string& line)
+    {
+        while (true)
+        {
+            size_t end = buffer.find('\n', start);
+            if (end != string::npos)
+            {
+                line.assign(buffer, start, end - start);
+                start = end + 1;
+                return true;
+            }
+            if (!fill())
+                return false;
+        }
+    }
+
+    // Reads exactly <length> bytes. Returns false if the connection was closed
+    bool read_bytes(size_t length, string& bytes)
+    {
+        while (buffer.size() - start < length)
+            if (!fill())
+                return false;
+
+        bytes.assign(buffer, start, length);
+        start += length;
+        return true;
+    }
+
+    // The last read failed because nothing was received for IDLE_TIMEOUT_SECONDS. Reading can be tried again
+    bool timed_out() const { return idle; }
+
+private:
+    int connection;
+    string buffer;
+    // Where unread data starts in the buffer
+    size_t start;
+    bool idle = false;
+
+    bool fill()
+    {
+        buffer.erase(0, start);
+        start = 0;
+
+        char chunk[4096];
+        ssize_t received = recv(connection, chunk, sizeof(chunk), 0);
+        idle = received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        if (received <= 0)
+            return false;
+        buffer.append(chunk, static_cast<size_t>(received));
+        return true;
+    }
+};
+
+static bool send_all(int connection, const string& data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// A client connection. The socket is closed once its reader and every request it sent are done
+struct TuringServer::Connection
+{
+    explicit Connection(int _socket) : socket(_socket), next_response(0), pending(0), failed(false) {}
+    ~Connection() { close(socket); }
+
+    const int socket;
+    std::mutex mutex;
+    // A response was sent
+    std::condition_variable sent;
+    // Responses finished before the ones in front of them
+    std::map<unsigned long long, string> responses;
+    // Number of the request whose response goes out next
+    unsigned long long next_response;
+    // Requests read whose response was not sent yet
+    unsigned int pending;
+    // The client stopped receiving, so responses are thrown away
+    bool failed;
+
+    // Sends the response once the responses to every request before it have been sent
+    void respond(unsigned long long number, string response)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        responses.emplace(number, std::move(response));
+        for (auto next = responses.find(next_response); next != responses.end(); next = responses.find(next_response))
+        {
+            if (!failed && !send_all(socket, next->second))
+                failed = true;
+            responses.erase(next);
+            next_response++;
+            pending--;
+        }
+        sent.notify_all();
+    }
+
+    bool idle()
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return pending == 0;
+    }
+};
+
+
+TuringServer::TuringServer(string _socket_path, unsigned int _threads, size_t cache_capacity)
+    : socket_path(std::move(_socket_path)), threads(_threads == 0 ? 1 : _threads), cache(cache_capacity)
+{
+}
+
+bool TuringServer::run()
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path is too long: " << socket_path << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        std::cerr << "Error creating socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Remove the socket left by a previous run, but never a file that is not a socket
+    struct stat existing;
+    if (lstat(socket_path.c_str(), &existing) == 0)
+    {
+        if (!S_ISSOCK(existing.st_mode))
+        {
+            std::cerr << "Error listening on " << socket_path << ": a file that is not a socket is already there" << std::endl;
+            close(listener);
+            return false;
+        }
+        unlink(socket_path.c_str());
+    }
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0)
+    {
+        std::cerr << "Error listening on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        close(listener);
+        return false;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+        workers.emplace_back(&TuringServer::worker, this);
+
+    std::cout << "Listening on " << socket_path << " with " << threads << " threads" << std::endl;
+
+    while (true)
+    {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Error accepting connection: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        timeval timeout{};
+        timeout.tv_sec = IDLE_TIMEOUT_SECONDS;
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        // Waiting for a client to send something does not take a worker thread
+        std::thread{ &TuringServer::read_requests, this, std::make_shared<Connection>(connection) }.detach();
+    }
+
+    close(listener);
+    unlink(socket_path.c_str());
+    // Workers never stop; the process is exiting anyway
+    for (std::thread& worker : workers)
+        worker.detach();
+    return false;
+}
+
+void TuringServer::worker()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock{ jobs_mutex };
+            jobs_ready.wait(lock, [this]() { return !jobs.empty(); });
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+
+        job.connection->respond(job.number, execute(job));
+    }
+}
+
+void TuringServer::read_requests(std::shared_ptr<Connection> connection)
+{
+    ConnectionReader reader{ connection->socket };
+    // Only a connection with no requests running is closed for being idle
+    auto keep_reading = [&]() { return reader.timed_out() && !connection->idle(); };
+
+    // Values of the request being read
+    Job job{ connection, 0, string{}, "0", DEFAULT_MAX_STEPS, string{} };
+    unsigned long long requests = 0;
+    // Responds right away, in order with the requests before it
+    auto respond = [&](string response)
+    {
+        {
+            std::lock_guard<std::mutex> lock{ connection->mutex };
+            connection->pending++;
+        }
+        connection->respond(requests++, std::move(response));
+    };
+
+    string line;
+    while (true)
+    {
+        if (!reader.read_line(line))
+        {
+            if (keep_reading())
+                continue;
+            return;
+        }
+
+        // <key> <value>
+        size_t separator = line.find(' ');
+        string key = line.substr(0, separator);
+        string value = separator == string::npos ? string{} : line.substr(separator + 1);
+
+        if (key == "stats")
+        {
+            std::ostringstream response;
+            response << "hits " << cache.get_hits() << '\n'
+                     << "misses " << cache.get_misses() << '\n'
+                     << "programs " << cache.size() << '\n'
+                     << "end\n";
+            respond(response.str());
+        }
+        else if (key == "input")
+            job.input = value;
+        else if (key == "state")
+            job.initial_state = value;
+        else if (key == "max-steps")
+            job.max_steps = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "program")
+        {
+            char* end;
+            unsigned long long length = std::strtoull(value.c_str(), &end, 10);
+            // The program is not read, so the rest of the connection can't be understood either
+            if (value.empty() || *end != '\0' || length > MAX_PROGRAM_SIZE)
+            {
+                respond("error Program length must be a number up to " + std::to_string(MAX_PROGRAM_SIZE) + "\nend\n");
+                return;
+            }
+
+            while (!reader.read_bytes(static_cast<size_t>(length), job.code))
+                if (!keep_reading())
+                    return;
+
+            // A client that sends requests faster than they run has to wait for some of them to finish
+            {
+                std::unique_lock<std::mutex> lock{ connection->mutex };
+                connection->sent.wait(lock, [&]() { return connection->pending < MAX_PENDING_REQUESTS; });
+                connection->pending++;
+            }
+            job.number = requests++;
+            {
+                std::lock_guard<std::mutex> lock{ jobs_mutex };
+                jobs.push(std::move(job));
+            }
+            jobs_ready.notify_one();
+
+            // Next request starts from the defaults
+            job = Job{ connection, 0, string{}, "0", DEFAULT_MAX_STEPS, string{} };
+        }
+        else if (!key.empty())
+            respond("error Unknown request: " + key + "\nend\n");
+    }
+}
+
+string TuringServer::execute(const Job& job)
+{
+    std::shared_ptr<const TuringProgram> program = cache.get(job.code);
+    // The initial state is not in the program; cached programs are shared, so use a copy
+    if (program->find_state(job.initial_state) == TuringProgram::WILDCARD)
+    {
+        auto copy = std::make_shared<TuringProgram>(*program);
+        copy->state_id(job.initial_state);
+        copy->expand_wildcards();
+        program = copy;
+    }
+
+    TuringCore core{ job.input, program->find_state(job.initial_state) };
+    StepResult result = StepResult::ok;
+    while (core.get_steps() < job.max_steps && (result = core.step(*program)) == StepResult::ok)
+        ;
+
+    std::ostringstream response;
+    response << "status " << result_name(result) << '\n'
+             << "steps " << core.get_steps() << '\n'
+             << "state " << program->state_name(core.get_state()) << '\n'
+             << "position " << core.get_position() << '\n'
+             << "tape " << core.get_tape() << '\n';
+    if (result == StepResult::error)
+        response << "error " << core.error_message() << '\n';
+    response << "end\n";
+    return response.str();
+}
+
+#endif
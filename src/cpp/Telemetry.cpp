@@ -0,0 +1,152 @@
+#include "Telemetry.h"
+
+#ifndef WIN32 // Linux
+
+#include <cstdio>
+#include <iostream>
+#include <csignal>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+using std::string;
+
+// Write end of the pipe of the active Telemetry, for the SIGUSR1 handler
+static volatile sig_atomic_t signal_pipe = -1;
+
+// Bytes written to the pipe
+static const char WAKE_SNAPSHOT = 's';
+static const char WAKE_STOP     = 'q';
+
+static void on_sigusr1(int)
+{
+    if (signal_pipe >= 0)
+    {
+        // write() is async-signal-safe; if the pipe is full a snapshot is already pending
+        ssize_t ignored = write(signal_pipe, &WAKE_SNAPSHOT, 1);
+        (void)ignored;
+    }
+}
+
+// Resident set size of this process in KiB, 0 if unknown
+static unsigned long long rss_kb()
+{
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm == nullptr)
+        return 0;
+
+    unsigned long long size = 0, resident = 0;
+    int read = std::fscanf(statm, "%llu %llu", &size, &resident);
+    std::fclose(statm);
+
+    return read == 2 ? resident * static_cast<unsigned long long>(sysconf(_SC_PAGESIZE)) / 1024 : 0;
+}
+
+static string json_string(const string& value)
+{
+    string escaped = "\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char code[7];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+            escaped += c;
+    }
+    return escaped + '"';
+}
+
+Telemetry::Telemetry(const TuringProgram& _program, std::ostream& _out, unsigned int interval_ms)
+    : program(_program), out(_out), interval(interval_ms == 0 ? 1 : interval_ms), start(std::chrono::steady_clock::now()),
+      steps(0), tape_size(0), position(0), state(TuringProgram::WILDCARD), last_steps(0), last_time(start), wake_pipe{ -1, -1 }
+{
+    if (pipe(wake_pipe) != 0)
+    {
+        std::cerr << "Error starting telemetry: could not create pipe" << std::endl;
+        wake_pipe[0] = wake_pipe[1] = -1;
+        return;
+    }
+
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+    signal_pipe = wake_pipe[1];
+    std::signal(SIGUSR1, on_sigusr1);
+
+    sampler = std::thread(&Telemetry::sample, this);
+}
+
+Telemetry::~Telemetry()
+{
+    if (!sampler.joinable())
+        return;
+
+    std::signal(SIGUSR1, SIG_DFL);
+    signal_pipe = -1;
+    ssize_t ignored = write(wake_pipe[1], &WAKE_STOP, 1);
+    (void)ignored;
+
+    sampler.join();
+    write_snapshot("final");
+
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+}
+
+void Telemetry::sample()
+{
+    auto next = std::chrono::steady_clock::now() + interval;
+
+    while (true)
+    {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now());
+        pollfd wake{ wake_pipe[0], POLLIN, 0 };
+        int ready = poll(&wake, 1, wait.count() > 0 ? static_cast<int>(wait.count()) : 0);
+
+        if (ready > 0)
+        {
+            char reason;
+            if (read(wake_pipe[0], &reason, 1) == 1)
+            {
+                if (reason == WAKE_STOP)
+                    return;
+                write_snapshot("signal");
+            }
+            continue;
+        }
+
+        write_snapshot("interval");
+        next += interval;
+    }
+}
+
+void Telemetry::write_snapshot(const char* reason)
+{
+    auto now = std::chrono::steady_clock::now();
+    unsigned long long current_steps = steps.load(std::memory_order_relaxed);
+    int current_state = state.load(std::memory_order_relaxed);
+
+    double elapsed = std::chrono::duration<double>(now - last_time).count();
+    double steps_per_second = elapsed > 0 ? static_cast<double>(current_steps - last_steps) / elapsed : 0;
+    last_steps = current_steps;
+    last_time = now;
+
+    char numbers[256];
+    std::snprintf(numbers, sizeof(numbers),
+                  "\"seconds\":%.3f,\"steps\":%llu,\"steps_per_second\":%.0f,\"tape\":%zu,\"position\":%u,",
+                  std::chrono::duration<double>(now - start).count(), current_steps, steps_per_second,
+                  tape_size.load(std::memory_order_relaxed), position.load(std::memory_order_relaxed));
+
+    string line = string("{\"reason\":\"") + reason + "\"," + numbers
+                + "\"state\":" + (current_state >= 0 ? json_string(program.state_name(current_state)) : "null")
+                + ",\"rss_kb\":" + std::to_string(rss_kb()) + "}\n";
+    out << line << std::flush;
+}
+
+#endif
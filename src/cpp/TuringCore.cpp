@@ -0,0 +1,84 @@
+#include "TuringCore.h"
+using std::string;
+
+const char* result_name(StepResult result)
+{
+    return result == StepResult::halt ? "halt" : result == StepResult::error ? "error" : "limit";
+}
+
+TuringCore::TuringCore(const string& _tape, int initial_state)
+    : tape(_tape), position(0), state(initial_state), steps(0), event({})
+{
+    if (_tape.empty())
+        tape = " ";
+}
+
+StepResult TuringCore::step(const TuringProgram& program)
+{
+    event = StepEvent{};
+
+    // look for a matching current_symbol in a matching current_state
+    const TuringInstruction* instruction = program.match(state, tape[position]);
+    if (instruction == nullptr)
+        return StepResult::halt;
+    if (!instruction->error.empty())
+    {
+        error = instruction->error;
+        return StepResult::error;
+    }
+
+    // Found a matching instruction in code. Now handle it
+    event.instruction = instruction;
+    event.write_position = position;
+
+    // * is no change; no need to write new_symbol if it's the same as old
+    if (instruction->new_symbol != '*' && instruction->new_symbol != tape[position])
+    {
+        // Overwrite symbol in the tape
+        tape[position] = instruction->new_symbol;
+        event.wrote = true;
+    }
+
+    // Move left or right; * is no change
+    switch (instruction->move_direction)
+    {
+    case '*':
+        break;
+    case 'l':
+        if (position == 0)
+        {
+            tape.insert(tape.begin(), ' ');
+            event.move = StepEvent::Move::grow_left;
+        }
+        else
+        {
+            position--;
+            event.move = StepEvent::Move::left;
+        }
+        break;
+    case 'r':
+        // NOTE: the head stays on the last cell when the tape grows to the right
+        if (position >= tape.size() - 1)
+        {
+            tape.append(" ");
+            event.move = StepEvent::Move::grow_right;
+        }
+        else
+        {
+            position++;
+            event.move = StepEvent::Move::right;
+        }
+        break;
+    // Direction is not l or r
+    default:
+        error = "Syntax Error (line " + std::to_string(instruction->line) + "): Move_Direction must be either r or l";
+        return StepResult::error;
+    }
+
+    // * is no change
+    if (instruction->new_state != TuringProgram::WILDCARD)
+        state = instruction->new_state;
+
+    steps += instruction->steps;
+    return StepResult::ok;
+}
@@ -1,183 +1,167 @@
 #include "TuringMachine.h"
-#include <array>
+#include "Optimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <memory>
+#include <sstream>
 using std::string;
 
-TuringMachine::TuringMachine(const string& _tape, string initial_state, std::ifstream& instructions_file, TuringConsole& _output)
-    : position(0), tape(_tape), current_state(initial_state), instructions(instructions_file), output(_output)
+TuringMachine::TuringMachine(const string& _tape, string initial_state, std::ifstream& instructions_file, bool optimize)
+    : source(TuringProgram::read_lines(instructions_file)), optimized(optimize), program(source),
+      core(_tape, program.state_id(initial_state)), current_line(0), dropped_frames(0)
 {
-    if (_tape.empty())
-        tape = " ";
+    if (optimize)
+    {
+        ProgramOptimizer optimizer{ program, initial_state };
+        program = optimizer.get_program();
+        core = TuringCore{ _tape, optimizer.get_initial_state() };
+    }
     else
-        tape = _tape;
+        program.expand_wildcards();
 
-    output.set_tape_value(tape);
+    // The console reads the code again to display it
+    instructions_file.clear();
+    instructions_file.seekg(0);
 }
 
-bool TuringMachine::step()
+// Takes 1 of the steps requested while paused. Returns false if there are none
+static bool take_step_request(MachineControl& control)
 {
-    // <state> <symbol> <new_symbol> <r | l> <new_state>
+    unsigned int requests = control.step_requests.load(std::memory_order_relaxed);
+    while (requests > 0 && !control.step_requests.compare_exchange_weak(requests, requests - 1, std::memory_order_relaxed))
+        ;
+    return requests > 0;
+}
 
-    // First line is line 1
-    unsigned int line_num = 0;
+// Steps the machine takes between frames while it runs. Making a frame costs more than a step,
+// and the console only draws one every 16ms anyway
+static const unsigned int FRAME_INTERVAL = 4096;
 
-    // look for a matching current_symbol in a matching current_state
-    if (instructions.is_open())
-        while (instructions.good())
+void TuringMachine::run(FrameBuffer& frames, MachineControl& control)
+{
+    StepResult result = StepResult::ok;
+    bool finished = false;
+    // The console has to be sent a frame even if the machine does not step
+    bool changed = true;
+    // Steps taken since the last frame
+    unsigned int unpublished = 0;
+    int scroll = control.tape_scroll.load(std::memory_order_relaxed);
+
+    while (!control.quit.load(std::memory_order_relaxed))
+    {
+        if (control.reload.load(std::memory_order_relaxed) != nullptr)
         {
-            string line;
-            std::getline(instructions, line);
-            // First line is line 1
-            line_num++;
-
-            std::array<string, 5> read_order = {
-                string{}, // state
-                string{}, // symbol
-                string{}, // new_symbol
-                string{}, // move_direction (r | l)
-                string{}  // new_state
-            };
-            unsigned short read_from = 0;
-            bool reading = false;
-
-            // assign values
-            for (char c : line)
+            std::unique_ptr<string> code{ control.reload.exchange(nullptr, std::memory_order_acquire) };
+            if (code)
             {
-                // comment, can be skipped
-                if (c == ';')
-                    break;
-
-                // whitespace used as separator
-                if (c == ' ' && reading)
-                {
-                    reading = false;
-                    // move on to reading symbol
-                    if (read_from < read_order.size() - 1)
-                        read_from++;
-                    // done reading state and symbol
-                    else if (read_from >= read_order.size() - 1)
-                        break;
-                    continue;
-                }
-                else if (c != ' ' && reading)
+                reload(*code, control);
+                // The new code may go on from where the machine halted or found an error
+                if (finished && !optimized)
                 {
-                    read_order[read_from] += c;
-                }
-                else if (c != ' ' && !reading)
-                {
-                    reading = true;
-                    read_order[read_from] += c;
+                    control.paused.store(true, std::memory_order_relaxed);
+                    finished = false;
+                    result = StepResult::ok;
                 }
+                changed = true;
             }
+        }
 
-            // Ignore this line if state does not match; "*" is wildcard
-            if (read_order[0] == current_state || read_order[0] == "*")
-            {
-                // Current_Symbol
-                if (read_order[1].size() > 1)
-                {
-                    std::cerr << "Syntax Error (line " << line_num << "): Symbol must only be 1 character long" << std::endl;
-                    return false;
-                }
-                else if (read_order[1].empty())
-                {
-                    std::cerr << "Error (line " << line_num << "): Could not find Symbol character" << std::endl;
-                    return false;
-                }
-                // New_Symbol
-                if (read_order[2].size() > 1)
-                {
-                    std::cerr << "Syntax Error (line " << line_num << "): New_Symbol must only be 1 character long" << std::endl;
-                    return false;
-                }
-                else if (read_order[2].empty())
-                {
-                    std::cerr << "Error (line " << line_num << "): Could not find New_Symbol character" << std::endl;
-                    return false;
-                }
-                // Move_Direction
-                if (read_order[3].size() > 1)
-                {
-                    std::cerr << "Syntax Error (line " << line_num << "): Move_Direction must only be 1 character long" << std::endl;
-                    return false;
-                }
-                else if (read_order[3].empty())
-                {
-                    std::cerr << "Error (line " << line_num << "): Could not find Move_Direction character" << std::endl;
-                    return false;
-                }
+        // Scrolling changes the part of the tape in the frame even if the machine does not move
+        int new_scroll = control.tape_scroll.load(std::memory_order_relaxed);
+        if (new_scroll != scroll)
+        {
+            scroll = new_scroll;
+            changed = true;
+        }
 
-                string& state       = read_order[0];
-                char symbol         = read_order[1][0];
-                char new_symbol     = read_order[2][0];
-                char move_direction = std::tolower(read_order[3][0]);
-                string& new_state   = read_order[4];
-                // _ represents space
-                if (symbol == '_')
-                    symbol = ' ';
-                if (new_symbol == '_')
-                    new_symbol = ' ';
-
-                // State and Symbol match current
-                if (symbol == tape[position] || symbol == '*')
-                {
-                    // Found a matching instruction in code. Now handle it
-
-                    output.set_current_code_line(line_num, instructions);
-
-                    // * is no change; no need to write new_symbol if it's the same as old
-                    if (new_symbol != '*' && new_symbol != tape[position])
-                    {
-                        // Overwrite symbol in the tape
-                        tape[position] = new_symbol;
-                        output.write_at(new_symbol, position);
-                    }
-
-                    // Move left or right; * is no change
-                    if (move_direction != '*')
-                    {
-                        if (move_direction == 'l' && position == 0)
-                        {
-                            tape.insert(tape.begin(), ' ');
-                            output.set_tape_value(tape);
-                        }
-                        else if (move_direction == 'r' && position >= tape.size() - 1)
-                        {
-                            tape.append(" ");
-                            output.set_tape_value(tape);
-                        }
-
-                        else if (move_direction == 'l')
-                        {
-                            position--;
-                            output.set_tape_cursor(position, tape);
-                        }
-                        else if (move_direction == 'r')
-                        {
-                            position++;
-                            output.set_tape_cursor(position, tape);
-                        }
-
-                        // Direction is not l or r
-                        else
-                        {
-                            std::cerr << "Syntax Error (line " << line_num << "): Move_Direction must be either r or l" << std::endl;
-                            return false;
-                        }
-                    }
-
-                    // * is no change
-                    if (new_state != "*")
-                        current_state = new_state;
-
-                    // TODO: highlight the line that will be executed next
-
-                    // Step done successfully
-                    return true;
-                }
-            }
+        bool stepping = !finished && (!control.paused.load(std::memory_order_relaxed) || take_step_request(control));
+
+        // The frame replaces the one before it, so the console always draws the newest one
+        if (changed || (unpublished > 0 && (!stepping || unpublished >= FRAME_INTERVAL)))
+        {
+            make_frame(frames.back(), control, result, finished);
+            if (frames.publish())
+                dropped_frames++;
+            changed = false;
+            unpublished = 0;
         }
-    else
-        std::cerr << "Error opening file containing Turing instructions" << std::endl;
-    
-    return false;
+
+        if (!stepping)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        result = core.step(program);
+        if (core.last_event().instruction != nullptr)
+            current_line = core.last_event().instruction->line;
+        finished = result != StepResult::ok;
+        unpublished++;
+    }
+}
+
+void TuringMachine::reload(const string& code, MachineControl& control)
+{
+    if (optimized)
+    {
+        notice = "Not reloaded: the optimized program can't be changed";
+        return;
+    }
+
+    std::istringstream stream{ code };
+    std::vector<string> lines = TuringProgram::read_lines(stream);
+    int state = core.get_state();
+    bool had_lines = program.has_lines_for(state);
+    bool was_referred_to = program.refers_to(state);
+    SourceChange change = program.update_lines(source, lines);
+    source = std::move(lines);
+    notice = "Reloaded, " + std::to_string(change.parsed) + " lines parsed";
+
+    // The line executed last moved with the lines around it, or is gone if it was changed
+    if (current_line > change.first + change.removed)
+        current_line = static_cast<unsigned int>(current_line + change.added - change.removed);
+    else if (current_line > change.first)
+        current_line = 0;
+
+    // A halting state has no lines of its own, and a state run only by "*" lines or given with -s may have
+    // no line going to it, so it is only gone if the reload took away what it had
+    if ((had_lines && !program.has_lines_for(state)) || (was_referred_to && !program.refers_to(state)))
+    {
+        control.paused.store(true, std::memory_order_relaxed);
+        notice = "State " + program.state_name(core.get_state()) + " is no longer in the program. Paused";
+    }
+}
+
+void TuringMachine::make_frame(MachineFrame& frame, const MachineControl& control, StepResult result, bool finished) const
+{
+    const string& tape = core.get_tape();
+    unsigned int position = core.get_position();
+    size_t width = std::min<size_t>(control.tape_width.load(std::memory_order_relaxed), MachineFrame::TAPE_WINDOW);
+
+    // Keep the head in the middle of the display, then move by however far the tape was scrolled
+    size_t start = 0;
+    if (tape.size() > width)
+    {
+        long long last_start = static_cast<long long>(tape.size() - width);
+        long long centered = std::max(0LL, std::min(static_cast<long long>(position) - static_cast<long long>(width / 2), last_start));
+        long long scrolled = centered + control.tape_scroll.load(std::memory_order_relaxed);
+        start = static_cast<size_t>(std::max(0LL, std::min(scrolled, last_start)));
+    }
+
+    frame.steps = core.get_steps();
+    frame.line = current_line;
+    frame.position = position;
+    frame.tape_size = tape.size();
+    frame.window_start = start;
+    frame.window_length = static_cast<unsigned int>(std::min(width, tape.size() - start));
+    tape.copy(frame.tape, frame.window_length, start);
+
+    std::snprintf(frame.state, sizeof(frame.state), "%s", program.state_name(core.get_state()).c_str());
+    frame.finished = finished;
+    frame.result = result;
+    std::snprintf(frame.error, sizeof(frame.error), "%s", result == StepResult::error ? core.error_message().c_str() : "");
+    frame.dropped = dropped_frames;
+    std::snprintf(frame.notice, sizeof(frame.notice), "%s", notice.c_str());
 }
@@ -0,0 +1,359 @@
+#include "TuringProgram.h"
+#include <array>
+#include <cctype>
+#include <algorithm>
+using std::string;
+
+const int TuringProgram::WILDCARD;
+
+TuringProgram::TuringProgram(std::istream& source)
+    : TuringProgram(read_lines(source))
+{
+}
+
+TuringProgram::TuringProgram(const std::vector<string>& lines)
+{
+    for (const string& line : lines)
+        add_line(line);
+}
+
+std::vector<string> TuringProgram::read_lines(std::istream& source)
+{
+    std::vector<string> lines;
+    while (source.good())
+    {
+        string line;
+        std::getline(source, line);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void TuringProgram::add_line(const string& line)
+{
+    // First line is line 1
+    instructions.push_back(parse_line(line, static_cast<unsigned int>(instructions.size() + 1)));
+    table.clear();
+}
+
+TuringInstruction TuringProgram::parse_line(const string& line, unsigned int line_num)
+{
+    // <state> <symbol> <new_symbol> <r | l> <new_state>
+
+    std::array<string, 5> read_order = {
+        string{}, // state
+        string{}, // symbol
+        string{}, // new_symbol
+        string{}, // move_direction (r | l)
+        string{}  // new_state
+    };
+    unsigned short read_from = 0;
+    bool reading = false;
+
+    // assign values
+    for (char c : line)
+    {
+        // comment, can be skipped
+        if (c == ';')
+            break;
+
+        // whitespace used as separator
+        if (c == ' ' && reading)
+        {
+            reading = false;
+            // move on to reading symbol
+            if (read_from < read_order.size() - 1)
+                read_from++;
+            // done reading state and symbol
+            else if (read_from >= read_order.size() - 1)
+                break;
+            continue;
+        }
+        else if (c != ' ' && reading)
+        {
+            read_order[read_from] += c;
+        }
+        else if (c != ' ' && !reading)
+        {
+            reading = true;
+            read_order[read_from] += c;
+        }
+    }
+
+    TuringInstruction instruction{};
+    instruction.line = line_num;
+    // "*" is wildcard
+    instruction.state = read_order[0] == "*" ? WILDCARD : state_id(read_order[0]);
+
+    // Current_Symbol
+    if (read_order[1].size() > 1)
+        instruction.error = "Syntax Error (line " + std::to_string(line_num) + "): Symbol must only be 1 character long";
+    else if (read_order[1].empty())
+        instruction.error = "Error (line " + std::to_string(line_num) + "): Could not find Symbol character";
+    // New_Symbol
+    else if (read_order[2].size() > 1)
+        instruction.error = "Syntax Error (line " + std::to_string(line_num) + "): New_Symbol must only be 1 character long";
+    else if (read_order[2].empty())
+        instruction.error = "Error (line " + std::to_string(line_num) + "): Could not find New_Symbol character";
+    // Move_Direction
+    else if (read_order[3].size() > 1)
+        instruction.error = "Syntax Error (line " + std::to_string(line_num) + "): Move_Direction must only be 1 character long";
+    else if (read_order[3].empty())
+        instruction.error = "Error (line " + std::to_string(line_num) + "): Could not find Move_Direction character";
+    else
+    {
+        instruction.symbol         = read_order[1][0];
+        instruction.new_symbol     = read_order[2][0];
+        instruction.move_direction = static_cast<char>(std::tolower(read_order[3][0]));
+        // * is no change
+        instruction.new_state      = read_order[4] == "*" ? WILDCARD : state_id(read_order[4]);
+        // _ represents space
+        if (instruction.symbol == '_')
+            instruction.symbol = ' ';
+        if (instruction.new_symbol == '_')
+            instruction.new_symbol = ' ';
+    }
+
+    return instruction;
+}
+
+SourceChange TuringProgram::update_lines(const std::vector<string>& old_source, const std::vector<string>& new_source)
+{
+    // Lines that did not change at the start and at the end
+    size_t prefix = 0;
+    while (prefix < old_source.size() && prefix < new_source.size() && old_source[prefix] == new_source[prefix])
+        prefix++;
+    size_t suffix = 0;
+    while (suffix < old_source.size() - prefix && suffix < new_source.size() - prefix
+           && old_source[old_source.size() - 1 - suffix] == new_source[new_source.size() - 1 - suffix])
+        suffix++;
+
+    size_t removed = old_source.size() - prefix - suffix;
+    size_t added = new_source.size() - prefix - suffix;
+    size_t old_states = states.size();
+    // Parsing can add states, which removes the table
+    std::vector<int> old_table;
+    old_table.swap(table);
+
+    // Rows of the table that change. A line for "*" changes every row
+    std::vector<bool> changed(states.size(), false);
+    bool changed_all = false;
+    auto mark = [&](const TuringInstruction& instruction)
+    {
+        if (instruction.state == WILDCARD)
+            changed_all = true;
+        else
+        {
+            if (changed.size() < states.size())
+                changed.resize(states.size(), false);
+            changed[instruction.state] = true;
+        }
+    };
+
+    std::vector<TuringInstruction> parsed;
+    for (size_t i = prefix; i < prefix + removed; i++)
+        mark(instructions[i]);
+    for (size_t i = prefix; i < prefix + added; i++)
+    {
+        parsed.push_back(parse_line(new_source[i], static_cast<unsigned int>(i + 1)));
+        mark(parsed.back());
+    }
+
+    instructions.erase(instructions.begin() + prefix, instructions.begin() + prefix + removed);
+    instructions.insert(instructions.begin() + prefix, parsed.begin(), parsed.end());
+
+    // The lines after the change moved. Only error messages contain the line number
+    size_t reparsed = added;
+    if (added != removed)
+        for (size_t i = prefix + added; i < instructions.size(); i++)
+        {
+            instructions[i].line = static_cast<unsigned int>(i + 1);
+            if (!instructions[i].error.empty())
+            {
+                instructions[i] = parse_line(new_source[i], static_cast<unsigned int>(i + 1));
+                reparsed++;
+            }
+        }
+
+    SourceChange change{ prefix, removed, added, reparsed };
+    if (old_table.empty())
+        return change;
+
+    table.swap(old_table);
+    table.resize(states.size() * 256, -1);
+    changed.resize(states.size(), false);
+
+    if (added != removed)
+    {
+        auto moved = static_cast<int>(prefix + removed);
+        auto shift = static_cast<int>(added) - static_cast<int>(removed);
+        for (int& instruction : table)
+            if (instruction >= moved)
+                instruction += shift;
+    }
+
+    for (size_t state = 0; state < states.size(); state++)
+        if (changed_all || changed[state] || state >= old_states)
+            expand_state(state);
+
+    return change;
+}
+
+bool TuringProgram::has_lines_for(int state) const
+{
+    for (const TuringInstruction& instruction : instructions)
+        if (instruction.state == state || instruction.state == WILDCARD)
+            return true;
+    return false;
+}
+
+bool TuringProgram::refers_to(int state) const
+{
+    for (const TuringInstruction& instruction : instructions)
+        if (instruction.state == state || (instruction.error.empty() && instruction.new_state == state))
+            return true;
+    return false;
+}
+
+void TuringProgram::add_instruction(int state, char symbol, char new_symbol, char move_direction, int new_state)
+{
+    TuringInstruction instruction{};
+    instruction.state          = state;
+    instruction.symbol         = symbol;
+    instruction.new_symbol     = new_symbol;
+    instruction.move_direction = move_direction;
+    instruction.new_state      = new_state;
+    instruction.line           = static_cast<unsigned int>(instructions.size() + 1);
+    instructions.push_back(std::move(instruction));
+    table.clear();
+}
+
+void TuringProgram::add_instruction(const TuringInstruction& instruction)
+{
+    instructions.push_back(instruction);
+    table.clear();
+}
+
+void TuringProgram::pop_instruction()
+{
+    instructions.pop_back();
+    table.clear();
+}
+
+int TuringProgram::state_id(const string& name)
+{
+    int id = find_state(name);
+    if (id != WILDCARD)
+        return id;
+
+    states.push_back(name);
+    table.clear();
+    return static_cast<int>(states.size() - 1);
+}
+
+int TuringProgram::find_state(const string& name) const
+{
+    for (size_t i = 0; i < states.size(); i++)
+        if (states[i] == name)
+            return static_cast<int>(i);
+    return WILDCARD;
+}
+
+const TuringInstruction* TuringProgram::match(int state, char symbol) const
+{
+    if (!table.empty() && state >= 0)
+    {
+        int instruction = table[state * 256 + static_cast<unsigned char>(symbol)];
+        return instruction < 0 ? nullptr : &instructions[instruction];
+    }
+
+    for (const TuringInstruction& instruction : instructions)
+        // Ignore this line if state does not match
+        if (instruction.state == state || instruction.state == WILDCARD)
+        {
+            if (!instruction.error.empty())
+                return &instruction;
+            if (instruction.symbol == symbol || instruction.symbol == '*')
+                return &instruction;
+        }
+
+    return nullptr;
+}
+
+void TuringProgram::expand_wildcards()
+{
+    table.assign(states.size() * 256, -1);
+
+    for (size_t state = 0; state < states.size(); state++)
+        expand_state(state);
+}
+
+void TuringProgram::expand_state(size_t state)
+{
+    int* row = &table[state * 256];
+    std::fill(row, row + 256, -1);
+    // Symbols that already have an instruction. The first match wins
+    unsigned int filled = 0;
+
+    for (size_t i = 0; i < instructions.size() && filled < 256; i++)
+    {
+        const TuringInstruction& instruction = instructions[i];
+        if (instruction.state != static_cast<int>(state) && instruction.state != WILDCARD)
+            continue;
+
+        // Applies to every symbol that is left
+        if (!instruction.error.empty() || instruction.symbol == '*')
+        {
+            for (unsigned int symbol = 0; symbol < 256; symbol++)
+                if (row[symbol] < 0)
+                    row[symbol] = static_cast<int>(i);
+            break;
+        }
+
+        int& entry = row[static_cast<unsigned char>(instruction.symbol)];
+        if (entry < 0)
+        {
+            entry = static_cast<int>(i);
+            filled++;
+        }
+    }
+}
+
+void TuringProgram::set_transition(int state, char symbol, int instruction)
+{
+    if (table.empty())
+        table.assign(states.size() * 256, -1);
+    table[state * 256 + static_cast<unsigned char>(symbol)] = instruction;
+}
+
+string TuringProgram::to_string() const
+{
+    string code;
+
+    for (const TuringInstruction& instruction : instructions)
+    {
+        // Keep the line so that line numbers do not change
+        if (!instruction.error.empty())
+        {
+            // Blank or comment line
+            if (instruction.state != WILDCARD && states[instruction.state].empty())
+                code += '\n';
+            else
+                code += "; " + instruction.error + '\n';
+            continue;
+        }
+
+        code += instruction.state == WILDCARD ? "*" : states[instruction.state];
+        code += ' ';
+        code += instruction.symbol == ' ' ? '_' : instruction.symbol;
+        code += ' ';
+        code += instruction.new_symbol == ' ' ? '_' : instruction.new_symbol;
+        code += ' ';
+        code += instruction.move_direction;
+        code += ' ';
+        code += instruction.new_state == WILDCARD ? "*" : states[instruction.new_state];
+        code += '\n';
+    }
+
+    return code;
+}
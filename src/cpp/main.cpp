@@ -1,7 +1,17 @@
 #include <string>
 #include <fstream>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <chrono>
 #include "Console.h"
 #include "TuringMachine.h"
+#include "Enumerator.h"
+#include "Server.h"
+#include "Optimizer.h"
+#include "Telemetry.h"
+#include "Fuzzer.h"
+#include "Accelerator.h"
 using std::string;
 using std::cout;
 
@@ -13,16 +23,64 @@ int main(int argc, char** argv)
         // TODO: add color coding
         cout << "Usage: \n"
              << "turing-interpreter [-i | --initial-input] ___ [-s | -initial-state] {DEFAULT: \"0\"} [-f | --program-file] {DEFAULT: \"Turing-Program.txt\"}\n"
+             << "turing-interpreter --enumerate [--states] {DEFAULT: 2} [--symbols] {DEFAULT: 2} [--max-steps] {DEFAULT: 1000} [--output] {DEFAULT: \"enumeration.txt\"}\n"
+             << "turing-interpreter --serve <socket-path> [--threads] {DEFAULT: number of cores} [--cache-size] {DEFAULT: 256}\n"
+             << "turing-interpreter --fuzz <iterations> [--seed] {DEFAULT: random} [--max-steps] {DEFAULT: 200} [--output] {DEFAULT: \"fuzz-reproducer.txt\"}\n"
              << "  --help, -h:               Show this help message"
              << "  --initial-input<string>:  \n"
              << "  --initial-state<string>:  \n"
-             << "  --program-file<path>:     \n";
+             << "  --program-file<path>:     Reloaded by the console whenever it is saved (Linux)\n"
+             << "  --headless:               Run without the console and print the result (no step limit unless --max-steps is given)\n"
+             << "  --telemetry<path | ->:    Write progress of a --headless run as JSON lines to a file (- for stderr). SIGUSR1 writes one right away\n"
+             << "  --telemetry-interval<ms>: {DEFAULT: 1000}\n"
+             << "  --accelerate:             Run a --headless program a block of the tape at a time, from a cache of block transitions, and report how well the cache worked\n"
+             << "  --block-size<number>:     Cells in a block of --accelerate (up to 32) {DEFAULT: 8}\n"
+             << "  --optimize, -O:           Run the optimized program (states merged, wildcards expanded, non-moving instructions fused)\n"
+             << "                            A fused instruction counts all of its steps at once, so a --headless run can stop a few steps past --max-steps\n"
+             << "  --dump-optimized:         Print the optimized program and exit\n"
+             << "  --check-optimized:        Run the original and optimized programs on the input (up to --max-steps) and compare them\n"
+             << "  --enumerate:              Run every machine with the given number of states and symbols, starting on a blank tape\n"
+             << "  --states<number>:         \n"
+             << "  --symbols<number>:        Including the blank\n"
+             << "  --max-steps<number>:      Machines still running after this many steps are undecided {DEFAULT: 1000}\n"
+             << "  --min-steps<number>:      Only report halting machines that run for at least this many steps\n"
+             << "  --report<halting | undecided | all>: Machines to write to the output {DEFAULT: halting}\n"
+             << "  --threads<number>:        {DEFAULT: number of cores}\n"
+             << "  --output<path>:           File where the results (or the program that reproduces a --fuzz mismatch) are written\n"
+             << "  --serve<path>:            Run programs sent to a Unix domain socket (see Server.h for the protocol)\n"
+             << "  --cache-size<number>:     Parsed programs kept in memory by --serve\n"
+             << "  --fuzz<iterations>:       Compare every execution engine against the original interpreter on random programs\n"
+             << "  --seed<number>:           Seed for the random programs of --fuzz\n";
 
         return 0;
     }
 
     string initial_input, initial_state = "0", program_file_path = "Turing-Program.txt";
     bool found_i = false; // throw error if initial_input is not given
+    bool optimize = false, dump_optimized = false, check_optimized = false;
+
+    // Headless
+    bool headless = false;
+    string telemetry_path;
+    unsigned int telemetry_interval = 1000;
+    bool found_telemetry_interval = false;
+    bool accelerate = false;
+    unsigned int block_size = 8;
+
+    // Enumeration
+    bool enumerate = false;
+    unsigned int states = 2, symbols = 2, threads = std::thread::hardware_concurrency();
+    // 0 is no limit given; each mode has its own default
+    unsigned long long max_steps = 0, min_steps = 0;
+    // Each mode has its own default output
+    string output_path, report = "halting";
+
+    // Server
+    string socket_path;
+    size_t cache_size = 256;
+
+    // Fuzzing
+    unsigned long long fuzz_iterations = 0, seed = std::random_device{}();
 
     // assign argument values
     for (int i = 0; i < argc; i++)
@@ -39,6 +97,115 @@ int main(int argc, char** argv)
             initial_state = argv[++i];
         else if (arg == "-f" || arg == "--program-file")
             program_file_path = argv[++i];
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--telemetry")
+            telemetry_path = argv[++i];
+        else if (arg == "--telemetry-interval")
+        {
+            telemetry_interval = std::stoul(argv[++i]);
+            found_telemetry_interval = true;
+        }
+        else if (arg == "--accelerate")
+            accelerate = true;
+        else if (arg == "--block-size")
+            block_size = std::stoul(argv[++i]);
+        else if (arg == "-O" || arg == "--optimize")
+            optimize = true;
+        else if (arg == "--dump-optimized")
+            dump_optimized = true;
+        else if (arg == "--check-optimized")
+            check_optimized = true;
+        else if (arg == "--enumerate")
+            enumerate = true;
+        else if (arg == "--states")
+            states = std::stoul(argv[++i]);
+        else if (arg == "--symbols")
+            symbols = std::stoul(argv[++i]);
+        else if (arg == "--max-steps")
+            max_steps = std::stoull(argv[++i]);
+        else if (arg == "--min-steps")
+            min_steps = std::stoull(argv[++i]);
+        else if (arg == "--report")
+            report = argv[++i];
+        else if (arg == "--threads")
+            threads = std::stoul(argv[++i]);
+        else if (arg == "--output")
+            output_path = argv[++i];
+        else if (arg == "--serve")
+            socket_path = argv[++i];
+        else if (arg == "--cache-size")
+            cache_size = std::stoul(argv[++i]);
+        else if (arg == "--fuzz")
+            fuzz_iterations = std::stoull(argv[++i]);
+        else if (arg == "--seed")
+            seed = std::stoull(argv[++i]);
+    }
+
+    if (!socket_path.empty())
+    {
+#ifdef WIN32
+        std::cerr << "--serve is not supported on Windows" << std::endl;
+#else
+        TuringServer server{ socket_path, threads, cache_size };
+        server.run();
+#endif
+        return 0;
+    }
+
+    if (fuzz_iterations > 0)
+    {
+        cout << "Seed: " << seed << std::endl;
+        DifferentialFuzzer fuzzer{ seed, max_steps == 0 ? 200 : max_steps };
+        return fuzzer.run(fuzz_iterations, output_path.empty() ? "fuzz-reproducer.txt" : output_path, cout) ? 0 : 1;
+    }
+
+    if (enumerate)
+    {
+        if (output_path.empty())
+            output_path = "enumeration.txt";
+
+        if (states == 0 || symbols < 2 || symbols > Enumerator::MAX_SYMBOLS)
+        {
+            std::cerr << "Argument --states must be at least 1 and --symbols between 2 and " << Enumerator::MAX_SYMBOLS << std::endl;
+            return 0;
+        }
+
+        std::ofstream output{ output_path };
+        if (!output.is_open())
+        {
+            std::cerr << "Error opening output file " << output_path << std::endl;
+            return 0;
+        }
+
+        Enumerator enumerator{ states, symbols, max_steps == 0 ? 1000 : max_steps, output };
+        enumerator.set_min_steps(min_steps);
+        if (report == "undecided")
+            enumerator.set_report(Enumerator::Report::undecided);
+        else if (report == "all")
+            enumerator.set_report(Enumerator::Report::all);
+
+        enumerator.run(threads);
+        enumerator.print_summary(cout);
+        return 0;
+    }
+
+    if (dump_optimized || check_optimized)
+    {
+        std::ifstream program_file{ program_file_path };
+        if (!program_file.is_open())
+        {
+            std::cerr << "Error opening file containing Turing instructions" << std::endl;
+            return 0;
+        }
+
+        TuringProgram program{ program_file };
+        ProgramOptimizer optimizer{ program, initial_state };
+        if (dump_optimized)
+            cout << optimizer.dump();
+        if (check_optimized)
+            return optimizer.check_equivalence(initial_input, max_steps == 0 ? 1000 : max_steps, cout) ? 0 : 1;
+        return 0;
     }
 
     if (!found_i)
@@ -47,6 +214,90 @@ int main(int argc, char** argv)
         return 0;
     }
 
+    // These only change how a --headless run goes
+    if (!headless && (!telemetry_path.empty() || found_telemetry_interval || accelerate))
+    {
+        std::cerr << "Arguments --telemetry, --telemetry-interval and --accelerate need --headless" << std::endl;
+        return 0;
+    }
+#ifdef WIN32
+    if (!telemetry_path.empty() || found_telemetry_interval)
+    {
+        std::cerr << "--telemetry is not supported on Windows" << std::endl;
+        return 0;
+    }
+#endif
+
+    if (headless)
+    {
+        std::ifstream program_file{ program_file_path };
+        if (!program_file.is_open())
+        {
+            std::cerr << "Error opening file containing Turing instructions" << std::endl;
+            return 0;
+        }
+
+        TuringProgram program{ program_file };
+        int state = program.state_id(initial_state);
+        if (optimize)
+        {
+            ProgramOptimizer optimizer{ program, initial_state };
+            program = optimizer.get_program();
+            state = optimizer.get_initial_state();
+        }
+        else
+            program.expand_wildcards();
+
+        TuringCore core{ initial_input, state };
+        StepResult result = StepResult::ok;
+
+        std::unique_ptr<BlockAccelerator> accelerator;
+        if (accelerate)
+            accelerator.reset(new BlockAccelerator{ program, block_size });
+        auto step = [&]() { return accelerator ? accelerator->step(core, max_steps) : core.step(program); };
+        auto start = std::chrono::steady_clock::now();
+        {
+#ifndef WIN32 // Linux
+            std::ofstream telemetry_file;
+            if (!telemetry_path.empty() && telemetry_path != "-")
+            {
+                telemetry_file.open(telemetry_path);
+                if (!telemetry_file.is_open())
+                {
+                    std::cerr << "Error opening telemetry file " << telemetry_path << std::endl;
+                    return 0;
+                }
+            }
+            std::ostream& telemetry_out = telemetry_path == "-" ? std::cerr : telemetry_file;
+            std::unique_ptr<Telemetry> telemetry;
+            if (!telemetry_path.empty())
+            {
+                telemetry.reset(new Telemetry{ program, telemetry_out, telemetry_interval });
+                telemetry->publish(core);
+            }
+
+            while ((max_steps == 0 || core.get_steps() < max_steps) && (result = step()) == StepResult::ok)
+                if (telemetry)
+                    telemetry->publish(core);
+#else
+            while ((max_steps == 0 || core.get_steps() < max_steps) && (result = step()) == StepResult::ok)
+                ;
+#endif
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (result == StepResult::error)
+            std::cerr << core.error_message() << std::endl;
+        cout << "status " << result_name(result) << '\n'
+             << "steps " << core.get_steps() << '\n'
+             << "state " << program.state_name(core.get_state()) << '\n'
+             << "position " << core.get_position() << '\n'
+             << "tape " << core.get_tape() << std::endl;
+        if (accelerator)
+            accelerator->print_report(cout, core.get_steps(), seconds);
+        return 0;
+    }
+
 #ifdef _DEBUG
     // Debug confirmation
     std::cout << "-i: " << initial_input << std::endl
@@ -56,18 +307,26 @@ int main(int argc, char** argv)
 #endif
 
     std::ifstream program_file{ program_file_path };
-    TuringConsole console{ program_file };
-    TuringMachine machine{ initial_input, initial_state, program_file, console };
-
-    if (!console.print_turing_code(program_file))
-        return 0;
-
-    while (true)
+    TuringMachine machine{ initial_input, initial_state, program_file, optimize };
     {
-        if (!machine.step())
-            break;
+        TuringConsole console{ program_file };
+        if (!console.print_turing_code(program_file))
+            return 0;
+#ifndef WIN32 // Linux
+        console.watch_code(program_file_path);
+#endif
+
+        // The machine runs on its own thread, so it never waits for the console to draw
+        FrameBuffer frames;
+        MachineControl control;
+        std::thread machine_thread{ &TuringMachine::run, &machine, std::ref(frames), std::ref(control) };
+        console.run(frames, control);
+        machine_thread.join();
     }
 
+    if (!machine.error_message().empty())
+        std::cerr << machine.error_message() << std::endl;
+
     program_file.close();
 
     return 0;
@@ -0,0 +1,74 @@
+#ifndef TURING_INTERPRETER_ACCELERATOR_H
+#define TURING_INTERPRETER_ACCELERATOR_H
+
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include "TuringProgram.h"
+#include "TuringCore.h"
+
+// Runs a TuringCore a block of the tape at a time.
+// The tape is split into blocks of block_size cells. The first time the head enters a block with some
+// contents in some state, the steps until the head leaves the block are simulated, and the result (new contents,
+// new state, side the head left from and number of steps) is kept in a bounded cache. When the same block
+// is entered the same way again, the whole result is copied to the tape at once.
+// Only blocks with tape on both sides are cached, so the tape never grows during a cached transition.
+// When lookups do not save enough steps, the accelerator steps normally for a while.
+class BlockAccelerator
+{
+public:
+    static const unsigned int MAX_BLOCK_SIZE = 32;
+
+    // block_size must be between 1 and MAX_BLOCK_SIZE. capacity (entries) is rounded up to a power of 2
+    explicit BlockAccelerator(const TuringProgram& _program, unsigned int _block_size = 8, size_t capacity = 1 << 16);
+
+    // Executes every step until the head leaves its block, or a single step if that can't be done from the cache.
+    // Never goes past max_steps (0 for no limit).
+    StepResult step(TuringCore& core, unsigned long long max_steps = 0);
+
+    unsigned long long get_lookups() const { return lookups; }
+    unsigned long long get_hits() const { return hits; }
+
+    // Prints statistics as "name value" lines, like --headless.
+    // speedup is steps executed per unit of work, where a normal step, a simulated step and a lookup are 1 unit each
+    void print_report(std::ostream& out, unsigned long long steps, double seconds) const;
+
+private:
+    struct Entry
+    {
+        // TuringProgram::WILDCARD if the entry is empty
+        int state;
+        unsigned int offset;
+        char cells[MAX_BLOCK_SIZE];
+
+        int new_state;
+        bool exit_right;
+        unsigned long long steps;
+        char new_cells[MAX_BLOCK_SIZE];
+    };
+
+    const TuringProgram& program;
+    const unsigned int block_size;
+    std::vector<Entry> cache;
+
+    // Cells inserted at the left of the tape, so that blocks stay on the same cells as the tape grows
+    unsigned long long left_growth;
+    // A block that could not be simulated; the head steps normally until it leaves it
+    bool skipping;
+    size_t skipped_block;
+    // Normal steps left before using the cache again
+    unsigned long long backoff;
+    unsigned long long backoff_length;
+    // Since the cache was last checked for paying off
+    unsigned int window_lookups;
+    unsigned long long window_saved;
+
+    unsigned long long lookups, hits, saved_steps, simulated_steps, plain_steps, fallbacks;
+
+    StepResult plain_step(TuringCore& core);
+    // Fills in the result of the entry. Returns false if the head halts or does not leave the block
+    bool simulate(Entry& entry) const;
+};
+
+
+#endif
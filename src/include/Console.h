@@ -5,8 +5,13 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <vector>
+#include <memory>
+#include "MachineFrame.h"
 #ifdef WIN32
 #include <Windows.h>
+#else // Linux
+#include "FileWatcher.h"
 #endif
 
 #ifdef _DEBUG
@@ -106,16 +111,26 @@ public:
     ~TuringConsole();
 #endif
 
-    void set_tape_cursor(unsigned short position, const std::string& tape);
-    // Highlights the current line in the code section. First line has value 0
-    void set_current_code_line(unsigned short line, std::ifstream& file);
-    void write_at(char symbol, unsigned short tape_position);
+    // Highlights the current line in the code section. First line is line 1 (0 for none)
+    void set_current_code_line(unsigned int line);
 
     // Tries to print out Turing instructions. returns false if fails
     bool print_turing_code(std::ifstream& file);
     // Displays user instructions for turing interpreter
     void print_instructions();
-    void set_tape_value(const std::string& tape);
+    // Draws the part of the tape in the frame, with the head highlighted
+    void set_tape_value(const MachineFrame& frame);
+    // Shows the step count, the state, and whether the machine is running
+    void print_status(const MachineFrame& frame, bool paused);
+
+#ifndef WIN32 // Linux
+    // Reloads the code whenever the file is saved, while run() is running
+    void watch_code(const std::string& path);
+#endif
+
+    // Draws the frames published by the machine and handles keyboard input until the user quits.
+    // This is the only thread that touches the console.
+    void run(FrameBuffer& frames, MachineControl& control);
 
 private:
 #ifdef WIN32
@@ -123,10 +138,16 @@ private:
     CONSOLE_SCREEN_BUFFER_INFO console_info;
 #endif
 
-    unsigned short turing_position;
     // First line is line 1
     unsigned int current_code_line;
     std::ifstream& code_file;
+    std::vector<std::string> code_lines;
+    // Lines of code scrolled past
+    unsigned int code_scroll;
+#ifndef WIN32 // Linux
+    std::string code_path;
+    std::unique_ptr<FileWatcher> code_watcher;
+#endif
 
 #ifdef WIN32
     short width, height;
@@ -143,6 +164,18 @@ private:
 #endif
     inline void set_position(coord pos);
     void draw_tape_scrollers(bool arrow1_disabled = true, bool arrow2_disabled = true);
+
+    // Lines of code that fit in the console
+    unsigned int code_rows() const { return height > (int)code_start.y ? height - code_start.y : 0; }
+    // Redraws a line of code if it is on screen
+    void draw_code_line(unsigned int line);
+    void scroll_code(int lines);
+    // Scrolls the code so that <line> is on screen
+    void show_code_line(unsigned int line);
+#ifndef WIN32 // Linux
+    // Redraws the lines of code that changed in the file, and sends the code to the machine
+    void reload_code(MachineControl& control);
+#endif
 };
 
 
@@ -0,0 +1,86 @@
+#ifndef TURING_INTERPRETER_ENUMERATOR_H
+#define TURING_INTERPRETER_ENUMERATOR_H
+
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include "TuringProgram.h"
+#include "TuringCore.h"
+
+// Searches every machine with a given number of states and symbols (busy-beaver style).
+// Machines are generated in Tree Normal Form: a machine runs (on a blank tape) until it reaches a
+// transition that is not defined yet, and only then is that transition filled in with every
+// possible value. States and symbols are only introduced in the order they are first used,
+// so machines that only differ by the names of their states/symbols are generated once.
+//
+// States are named 0, 1, 2, ... (0 is the initial state) and symbols are _, 1, 2, ...
+// A machine halts when no transition applies, same as in normal execution.
+class Enumerator
+{
+public:
+    // Which machines get written to the results
+    enum class Report
+    {
+        halting,
+        undecided,
+        all,
+    };
+
+    // Largest number of symbols that can be enumerated
+    static const unsigned int MAX_SYMBOLS = 36;
+
+    Enumerator(unsigned int _states, unsigned int _symbols, unsigned long long _max_steps, std::ostream& _results);
+
+    // Do not report halting machines that run for less steps than this
+    void set_min_steps(unsigned long long steps) { min_steps = steps; }
+    void set_report(Report _report) { report = _report; }
+
+    // Enumerates every machine, running them on the given number of threads
+    void run(unsigned int threads);
+    void print_summary(std::ostream& out) const;
+
+private:
+    enum class Outcome
+    {
+        halt,
+        // Reached the same configuration twice, or the same one shifted along the tape
+        cycler,
+        // Runs off into the blank part of the tape forever
+        escapee,
+        // Did not halt within max_steps
+        undecided,
+    };
+
+    const unsigned int states;
+    const unsigned int symbols;
+    const unsigned long long max_steps;
+    unsigned long long min_steps;
+    Report report;
+
+    std::ostream& results;
+    std::mutex results_mutex;
+
+    std::atomic<unsigned long long> machines;
+    std::atomic<unsigned long long> halting;
+    std::atomic<unsigned long long> cyclers;
+    std::atomic<unsigned long long> escapees;
+    std::atomic<unsigned long long> undecided;
+    std::atomic<unsigned long long> longest_run;
+
+    // Runs the machine until it halts, a decider proves that it never halts, or it reaches max_steps
+    Outcome simulate(const TuringProgram& program, TuringCore& core) const;
+    // The head is at the edge of the tape, on a blank, in the given state.
+    // Returns true if the machine will keep moving into the blank side forever.
+    bool escapes(const TuringProgram& program, int state, bool right) const;
+
+    // Simulates the machine and calls child() once for every way to define the transition it halted on
+    template <typename Callback>
+    void visit(TuringProgram& program, TuringCore core, unsigned int used_states, unsigned int used_symbols, Callback child);
+    // Visits the machine and all its children (depth first)
+    void search(TuringProgram& program, const TuringCore& core, unsigned int used_states, unsigned int used_symbols);
+
+    void write_result(const char* status, const TuringProgram& program, const TuringCore& core);
+};
+
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef TURING_INTERPRETER_FILE_WATCHER_H
+#define TURING_INTERPRETER_FILE_WATCHER_H
+
+#ifndef WIN32 // Linux
+
+#include <string>
+
+// Tells when a file has been written, with inotify.
+// Watches the directory of the file, so that it still works when an editor saves by replacing the file.
+class FileWatcher
+{
+public:
+    explicit FileWatcher(const std::string& path);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Does not wait. Returns true if the file was written or replaced since the last call
+    bool changed();
+
+private:
+    int inotify;
+    // Name of the file in its directory
+    std::string name;
+};
+
+#endif
+
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef TURING_INTERPRETER_FNV1A_H
+#define TURING_INTERPRETER_FNV1A_H
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a hash, for the keys of the caches. Bytes are added one after the other
+class Fnv1a
+{
+public:
+    void add(unsigned char byte)
+    {
+        h ^= byte;
+        h *= 1099511628211ull;
+    }
+
+    void add(const char* bytes, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            add(static_cast<unsigned char>(bytes[i]));
+    }
+
+    uint64_t value() const { return h; }
+
+private:
+    uint64_t h = 14695981039346656037ull;
+};
+
+
+#endif
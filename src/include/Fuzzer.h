@@ -0,0 +1,65 @@
+#ifndef TURING_INTERPRETER_FUZZER_H
+#define TURING_INTERPRETER_FUZZER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+#include <random>
+#include "TuringCore.h"
+
+// How a run ended
+struct FuzzOutcome
+{
+    // StepResult::ok if the step limit was reached
+    StepResult result;
+    unsigned long long steps;
+    std::string tape;
+    unsigned int position;
+    // Names the final state can have in the original program (merged states have more than 1)
+    std::vector<std::string> states;
+    std::string error;
+};
+
+// Runs random programs and inputs through the reference interpreter (the original TuringMachine::step(),
+// which scanned the program text line by line on every step) and through every execution engine,
+// and compares the tape, head, state and step count.
+// At the first mismatch the program and input are minimized and the program is written to a file.
+class DifferentialFuzzer
+{
+public:
+    // Runs <code> on <input> from <initial_state> for up to <max_steps>
+    using Engine = std::function<FuzzOutcome(const std::string& code, const std::string& input,
+                                             const std::string& initial_state, unsigned long long max_steps)>;
+
+    DifferentialFuzzer(unsigned long long seed, unsigned long long _max_steps);
+
+    void add_engine(const std::string& name, Engine engine);
+
+    // Returns false if an engine did not match the reference. The minimized program is written to reproducer_path
+    bool run(unsigned long long iterations, const std::string& reproducer_path, std::ostream& out);
+
+    static FuzzOutcome reference(const std::string& code, const std::string& input,
+                                 const std::string& initial_state, unsigned long long max_steps);
+
+private:
+    struct NamedEngine
+    {
+        std::string name;
+        Engine engine;
+    };
+
+    std::mt19937_64 random;
+    const unsigned long long max_steps;
+    std::vector<NamedEngine> engines;
+
+    std::string random_program();
+    std::string random_input();
+    std::string random_state();
+
+    // Describes how the engines differ from the reference. Empty if they all match
+    std::string compare(const std::string& code, const std::string& input, const std::string& initial_state) const;
+};
+
+
+#endif
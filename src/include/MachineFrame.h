@@ -0,0 +1,58 @@
+#ifndef TURING_INTERPRETER_MACHINE_FRAME_H
+#define TURING_INTERPRETER_MACHINE_FRAME_H
+
+#include <atomic>
+#include <string>
+#include "TripleBuffer.h"
+#include "TuringCore.h"
+
+// Everything the console needs to draw the machine at one point of its execution.
+// Published by the machine thread and drawn by the UI thread.
+struct MachineFrame
+{
+    // Most symbols of the tape that can be displayed at once
+    static const unsigned int TAPE_WINDOW = 512;
+
+    unsigned long long steps;
+    // Line of the instruction executed last (first line is line 1, 0 if none)
+    unsigned int line;
+    // Head position in the whole tape
+    unsigned int position;
+    size_t tape_size;
+    // The part of the tape in this frame: window_length symbols starting at window_start
+    size_t window_start;
+    unsigned int window_length;
+    char tape[TAPE_WINDOW];
+
+    char state[32];
+    // The machine halted or found an error. It only steps again if the program is reloaded
+    bool finished;
+    StepResult result;
+    char error[128];
+    // What happened when the program was last reloaded (empty if it was not)
+    char notice[128];
+    // Frames replaced by a newer one before the console drew them
+    unsigned long long dropped;
+};
+
+using FrameBuffer = TripleBuffer<MachineFrame>;
+
+// Requests from the UI thread to the machine thread
+struct MachineControl
+{
+    std::atomic<bool> quit{ false };
+    std::atomic<bool> paused{ false };
+    // Steps to execute while paused
+    std::atomic<unsigned int> step_requests{ 0 };
+    // How far the tape is scrolled from being centered on the head
+    std::atomic<int> tape_scroll{ 0 };
+    // Symbols the console can display
+    std::atomic<unsigned int> tape_width{ MachineFrame::TAPE_WINDOW };
+    // New code of the program file, not yet applied by the machine. Owned by whichever thread takes it out
+    std::atomic<std::string*> reload{ nullptr };
+
+    ~MachineControl() { delete reload.load(); }
+};
+
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TURING_INTERPRETER_OPTIMIZER_H
+#define TURING_INTERPRETER_OPTIMIZER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "TuringProgram.h"
+
+// Builds an equivalent program that runs faster:
+//  - Only states reachable from the initial state are kept, and lines that can never be the first match are dropped.
+//  - Chains of instructions that do not move the head (* direction) are fused into a single instruction.
+//  - States that behave the same for every symbol are merged.
+//  - Wildcards are expanded into a dense table of every state and symbol, so finding an instruction never scans the lines.
+// The optimized program executes the same number of steps (fused instructions count for every step they replace)
+// and leaves the same tape and head position. Merged states get the name of one of them.
+class ProgramOptimizer
+{
+public:
+    ProgramOptimizer(const TuringProgram& _original, const std::string& initial_state);
+
+    const TuringProgram& get_program() const { return optimized; }
+    int get_initial_state() const { return optimized_initial_state; }
+    // State of the optimized program that the state of the original program became, WILDCARD if it was dropped
+    int map_state(int original_state) const { return state_map[original_state]; }
+
+    // The optimized program as Turing code, with what was done to it
+    std::string dump() const;
+
+    // Runs both programs on the input (up to max_steps, or the step a fused instruction took the optimized one to)
+    // and compares the tape, head position, state and steps.
+    // Writes the differences to out and returns false if there are any
+    bool check_equivalence(const std::string& input, unsigned long long max_steps, std::ostream& out) const;
+
+private:
+    // What the machine does in a state when reading a symbol
+    struct Transition
+    {
+        bool halt;
+        TuringInstruction instruction;
+    };
+
+    TuringProgram original;
+    int original_initial_state;
+    TuringProgram optimized;
+    int optimized_initial_state;
+
+    // Symbols that appear in the program (and blank)
+    std::vector<char> alphabet;
+    // A symbol that does not appear in the program, to stand for all of them. 0 if all symbols are used
+    char other_symbol;
+    std::vector<int> state_map;
+
+    unsigned int merged_states;
+    unsigned int fused_instructions;
+    unsigned int dropped_lines;
+
+    // Finds the instruction executed for the state and symbol, fusing the instructions that follow it without moving
+    Transition transition(int state, char symbol, std::vector<bool>& used_lines) const;
+};
+
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef TURING_INTERPRETER_SERVER_H
+#define TURING_INTERPRETER_SERVER_H
+
+#ifndef WIN32 // Linux
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <atomic>
+#include <cstdint>
+#include "TuringProgram.h"
+
+// Parsed programs, keyed by a hash of their code. The least recently used program is dropped when full.
+class ProgramCache
+{
+public:
+    explicit ProgramCache(size_t _capacity);
+
+    // Returns the parsed program, parsing it only if it is not in the cache
+    std::shared_ptr<const TuringProgram> get(const std::string& code);
+
+    unsigned long long get_hits() const { return hits; }
+    unsigned long long get_misses() const { return misses; }
+    size_t size();
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        // Compared on lookup in case 2 programs have the same hash
+        std::string code;
+        std::shared_ptr<const TuringProgram> program;
+    };
+
+    const size_t capacity;
+    std::mutex mutex;
+    // Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> misses;
+
+    static uint64_t hash(const std::string& code);
+};
+
+// Runs Turing programs for clients connected to a Unix domain socket, so that a pipeline
+// does not pay for starting the process and parsing the program every time.
+//
+// A connection sends any number of requests, one after the other:
+//   input <tape>          (optional, rest of the line is the tape)
+//   state <name>          (optional, DEFAULT: 0)
+//   max-steps <number>    (optional, DEFAULT: 1000000)
+//   program <length>      (ends the request, followed by <length> bytes of Turing code, at most 1 MiB)
+// and gets back:
+//   status <halt | error | limit>
+//   steps <number>
+//   state <name>
+//   position <number>
+//   tape <tape>
+//   error <message>       (only if status is error)
+//   end
+// The line "stats" gets back the cache counters (hits, misses, programs) followed by "end".
+// A program that is too long gets back "error <message>" and "end", and the connection is closed.
+// Requests run on the worker threads as soon as they are read, so the requests of one connection can run
+// at the same time; responses are still sent in the order of the requests.
+// A connection is closed after 30 seconds without a request while none of its requests are running.
+class TuringServer
+{
+public:
+    TuringServer(std::string _socket_path, unsigned int _threads, size_t cache_capacity);
+
+    // Accepts connections until the process is stopped. Returns false if the socket could not be opened
+    bool run();
+
+private:
+    const std::string socket_path;
+    const unsigned int threads;
+    ProgramCache cache;
+
+    struct Connection;
+    // A request that was read, waiting for a worker thread
+    struct Job
+    {
+        std::shared_ptr<Connection> connection;
+        // Requests of a connection are numbered in the order they were read
+        unsigned long long number;
+        std::string input;
+        std::string initial_state;
+        unsigned long long max_steps;
+        std::string code;
+    };
+
+    std::queue<Job> jobs;
+    std::mutex jobs_mutex;
+    std::condition_variable jobs_ready;
+
+    void worker();
+    // Reads the requests of a connection and queues them for the workers (on a thread of its own)
+    void read_requests(std::shared_ptr<Connection> connection);
+    // Runs the request and returns the response
+    std::string execute(const Job& job);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef TURING_INTERPRETER_TELEMETRY_H
+#define TURING_INTERPRETER_TELEMETRY_H
+
+#ifndef WIN32 // Linux
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <thread>
+#include "TuringProgram.h"
+#include "TuringCore.h"
+
+// Progress of a long (headless) run, written as JSON lines every interval:
+//   {"reason":"interval","seconds":...,"steps":...,"steps_per_second":...,"tape":...,"position":...,"state":"...","rss_kb":...}
+// The stepping loop only stores the counters (relaxed atomics, no locks or syscalls); a separate thread
+// samples them. Sending SIGUSR1 to the process writes a snapshot right away.
+class Telemetry
+{
+public:
+    Telemetry(const TuringProgram& _program, std::ostream& _out, unsigned int interval_ms);
+    // Writes a last snapshot and stops sampling
+    ~Telemetry();
+
+    // Called by the stepping loop after every step
+    void publish(const TuringCore& core)
+    {
+        steps.store(core.get_steps(), std::memory_order_relaxed);
+        tape_size.store(core.get_tape().size(), std::memory_order_relaxed);
+        position.store(core.get_position(), std::memory_order_relaxed);
+        state.store(core.get_state(), std::memory_order_relaxed);
+    }
+
+private:
+    const TuringProgram& program;
+    std::ostream& out;
+    const std::chrono::milliseconds interval;
+    const std::chrono::steady_clock::time_point start;
+
+    std::atomic<unsigned long long> steps;
+    std::atomic<size_t> tape_size;
+    std::atomic<unsigned int> position;
+    std::atomic<int> state;
+
+    // Steps and time of the last snapshot, to calculate steps/s
+    unsigned long long last_steps;
+    std::chrono::steady_clock::time_point last_time;
+
+    // Wakes up the sampler: SIGUSR1 writes to it, and so does the destructor to stop it
+    int wake_pipe[2];
+    std::thread sampler;
+
+    void sample();
+    void write_snapshot(const char* reason);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef TURING_INTERPRETER_TRIPLE_BUFFER_H
+#define TURING_INTERPRETER_TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands the latest value from exactly one producer thread to exactly one consumer thread.
+// Neither side ever waits: a new value replaces the one the consumer has not taken yet.
+// The producer writes to one slot, the consumer reads another, and the third holds the latest value between them.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : back_index(0), middle(1), front_index(2) {}
+
+    // Producer only. Slot to write the next value to
+    T& back() { return slots[back_index]; }
+
+    // Producer only. Makes the value in back() the latest one.
+    // Returns true if it replaced a value the consumer never took
+    bool publish()
+    {
+        unsigned int previous = middle.exchange(back_index | FRESH, std::memory_order_acq_rel);
+        back_index = previous & ~FRESH;
+        return (previous & FRESH) != 0;
+    }
+
+    // Consumer only. Returns the latest value, or nullptr if it was already taken.
+    // The value can be read until the next call
+    const T* take()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return nullptr;
+
+        unsigned int previous = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = previous & ~FRESH;
+        return &slots[front_index];
+    }
+
+private:
+    // Set on the middle slot when it has a value the consumer has not taken
+    static const unsigned int FRESH = 4;
+
+    // On separate cache lines, so that the 2 threads do not keep invalidating each other's
+    unsigned int back_index;
+    alignas(64) std::atomic<unsigned int> middle;
+    alignas(64) unsigned int front_index;
+    T slots[3];
+};
+
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef TURING_INTERPRETER_CORE_H
+#define TURING_INTERPRETER_CORE_H
+
+#include <string>
+#include "TuringProgram.h"
+
+enum class StepResult
+{
+    ok,
+    // No instruction applies to the current state and symbol
+    halt,
+    // The instruction that applies has a syntax error
+    error,
+};
+
+// "halt", "error", or "limit" for ok (the step limit was reached before the machine stopped)
+const char* result_name(StepResult result);
+
+// What the last step did, so that a display can be updated without redrawing everything
+struct StepEvent
+{
+    enum class Move { none, left, right, grow_left, grow_right };
+
+    // nullptr if nothing was executed
+    const TuringInstruction* instruction;
+    // Position of the cell that was overwritten (position before moving)
+    unsigned int write_position;
+    bool wrote;
+    Move move;
+};
+
+// Tape, head and state of a Turing machine. Has no output, so it can be used for both
+// the interactive TuringMachine and headless execution (e.g. the Enumerator).
+class TuringCore
+{
+public:
+    TuringCore(const std::string& _tape, int initial_state);
+
+    // Executes the first instruction of the program that applies to the current state and symbol
+    StepResult step(const TuringProgram& program);
+
+    const std::string& get_tape() const { return tape; }
+    unsigned int get_position() const { return position; }
+    int get_state() const { return state; }
+    unsigned long long get_steps() const { return steps; }
+    const StepEvent& last_event() const { return event; }
+    // Set when step() returns StepResult::error
+    const std::string& error_message() const { return error; }
+
+private:
+    // Applies whole cached blocks of steps to the tape
+    friend class BlockAccelerator;
+
+    std::string tape;
+    unsigned int position;
+    int state;
+    unsigned long long steps;
+
+    StepEvent event;
+    std::string error;
+};
+
+
+#endif
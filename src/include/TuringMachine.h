@@ -2,26 +2,44 @@
 #define TURING_INTERPRETER_MACHINE_H
 
 #include <string>
-#include "Console.h"
+#include <vector>
+#include <fstream>
+#include "TuringProgram.h"
+#include "TuringCore.h"
+#include "MachineFrame.h"
 
 class TuringMachine
 {
 public:
-    TuringMachine(const std::string& _tape, std::string initial_state, std::ifstream& instructions_file, TuringConsole& _output);
+    // optimize: run the program built by ProgramOptimizer instead
+    TuringMachine(const std::string& _tape, std::string initial_state, std::ifstream& instructions_file, bool optimize = false);
 
-    const std::string& get_tape() { return tape; }
-    unsigned int get_position() { return position; }
+    const std::string& get_tape() { return core.get_tape(); }
+    unsigned int get_position() { return core.get_position(); }
+    const std::string& error_message() const { return core.error_message(); }
 
-    bool step();
+    // Runs the machine until control.quit is set (on the machine thread).
+    // Publishes a frame every few thousand steps and whenever it stops stepping, and never waits for the console.
+    // Code put in control.reload is applied between steps, keeping the tape, head and state.
+    void run(FrameBuffer& frames, MachineControl& control);
 
 private:
-    std::string tape;
-    std::ifstream& instructions;
-    TuringConsole& output;
-    unsigned int position;
+    // Lines of the program file, as the program was parsed from them
+    std::vector<std::string> source;
+    bool optimized;
+    TuringProgram program;
+    TuringCore core;
 
-    std::string current_state;
+    // Line of the instruction executed last, 0 if none
+    unsigned int current_line;
+    unsigned long long dropped_frames;
+    std::string notice;
+
+    // Parses the lines of the code that changed. Pauses if the current state lost its lines or the last line referring to it
+    void reload(const std::string& code, MachineControl& control);
+
+    void make_frame(MachineFrame& frame, const MachineControl& control, StepResult result, bool finished) const;
 };
 
 
-#endif
\ No newline at end of file
+#endif
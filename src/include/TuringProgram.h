@@ -0,0 +1,108 @@
+#ifndef TURING_INTERPRETER_PROGRAM_H
+#define TURING_INTERPRETER_PROGRAM_H
+
+#include <string>
+#include <vector>
+#include <istream>
+
+// One line of Turing code: <state> <symbol> <new_symbol> <r | l> <new_state>
+struct TuringInstruction
+{
+    // Index into the program's states, or TuringProgram::WILDCARD for "*"
+    int state;
+    // _ is already converted to space
+    char symbol;
+    char new_symbol;
+    // Lowercase. Not validated until the instruction is executed
+    char move_direction;
+    // Index into the program's states, or TuringProgram::WILDCARD for "*" (no change)
+    int new_state;
+    // First line is line 1
+    unsigned int line;
+    // Non-empty if the line has a syntax error. Only reported once the machine reaches this line
+    std::string error;
+    // Steps this instruction stands for (more than 1 when the optimizer fuses instructions)
+    unsigned int steps = 1;
+};
+
+// Lines of the source that TuringProgram::update_lines() replaced
+struct SourceChange
+{
+    // Index of the first line that changed (0 for line 1)
+    size_t first;
+    // Lines taken out and put in at that index
+    size_t removed;
+    size_t added;
+    // Lines parsed, including lines after the change that had to be parsed again
+    size_t parsed;
+};
+
+// Parsed Turing code. Every line of the source (comments and blank lines included) becomes
+// an instruction, so that the first-match-wins order and line numbers stay the same as in the file.
+class TuringProgram
+{
+public:
+    // "*" in place of a state
+    static const int WILDCARD = -1;
+
+    TuringProgram() = default;
+    explicit TuringProgram(std::istream& source);
+    // One instruction for each line, as if they were read from a source
+    explicit TuringProgram(const std::vector<std::string>& lines);
+
+    // Splits the source into lines the same way the program is parsed from it
+    static std::vector<std::string> read_lines(std::istream& source);
+
+    // Parses a line of code and appends it as the next line of the program
+    void add_line(const std::string& line);
+    // Appends an already parsed instruction, numbered as the next line
+    void add_instruction(int state, char symbol, char new_symbol, char move_direction, int new_state);
+    // Appends the instruction as it is (keeps its line number)
+    void add_instruction(const TuringInstruction& instruction);
+    // Removes the last instruction
+    void pop_instruction();
+    // Parses the lines that are different in new_source than in old_source (the code this program was parsed from),
+    // and updates the table in place if there is one. States are never removed, so state ids stay the same.
+    SourceChange update_lines(const std::vector<std::string>& old_source, const std::vector<std::string>& new_source);
+
+    // Returns the index of the state, adding it if it does not exist yet
+    int state_id(const std::string& name);
+    // Returns the index of the state, or WILDCARD if it does not exist
+    int find_state(const std::string& name) const;
+    const std::string& state_name(int id) const { return states[id]; }
+    size_t state_count() const { return states.size(); }
+    // Returns true if a line of the program is for the state or for "*"
+    bool has_lines_for(int state) const;
+    // Returns true if a line of the program is for the state or goes to it
+    bool refers_to(int state) const;
+
+    const std::vector<TuringInstruction>& get_instructions() const { return instructions; }
+    size_t size() const { return instructions.size(); }
+
+    // First instruction that applies to the state and symbol ("*" is wildcard).
+    // A line with an error applies as soon as its state matches. nullptr if no instruction applies (halt).
+    const TuringInstruction* match(int state, char symbol) const;
+
+    // Builds a table of the instruction that applies to every state and symbol, so that match()
+    // does not have to scan the lines. Adding lines or states afterwards removes the table.
+    void expand_wildcards();
+    // Sets the instruction (index) that applies to the state and symbol in the table, -1 to halt
+    void set_transition(int state, char symbol, int instruction);
+    bool has_table() const { return !table.empty(); }
+
+    // Writes the program back as Turing code, one instruction per line (_ for space)
+    std::string to_string() const;
+
+private:
+    std::vector<TuringInstruction> instructions;
+    std::vector<std::string> states;
+    // Index of the instruction for [state * 256 + symbol], -1 is halt
+    std::vector<int> table;
+
+    TuringInstruction parse_line(const std::string& line, unsigned int line_num);
+    // Fills in the row of the table for the state
+    void expand_state(size_t state);
+};
+
+
+#endif